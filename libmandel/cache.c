@@ -0,0 +1,119 @@
+// Iteration cache files: a CacheHeader followed by width*height uint16 counts
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "mandel.h"
+
+#define CACHE_MAGIC "MBIT"  // Cached iteration buffer file signature
+#define CACHE_VERSION 1
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t max_iter;
+    uint32_t checksum;      // FNV-1a over the counts
+    double center_x;
+    double center_y;
+    double scale;
+} CacheHeader;
+
+// Checksum of a cached iteration buffer (32-bit FNV-1a)
+static uint32_t cache_checksum(const uint16_t* counts, size_t count) {
+    const uint8_t* bytes = (const uint8_t*) counts;
+    uint32_t hash = 2166136261U;
+    for (size_t i = 0; i < count * sizeof(uint16_t); i++) {
+        hash ^= bytes[i];
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+// Store iteration counts for a view as a compact uint16 buffer with header and checksum.
+// The file is written next to path and renamed into place.
+int mandel_cache_write(const char* path, const MandelbrotState* state, int width, int height,
+                       const int* iterations) {
+    size_t count = (size_t)width * height;
+    uint16_t* counts = (uint16_t*) malloc(count * sizeof(uint16_t));
+    if (!counts) return 0;
+    for (size_t i = 0; i < count; i++) {
+        counts[i] = (uint16_t) iterations[i];
+    }
+
+    CacheHeader header = {0};
+    memcpy(header.magic, CACHE_MAGIC, 4);
+    header.version = CACHE_VERSION;
+    header.width = width;
+    header.height = height;
+    header.max_iter = MANDEL_MAX_ITER;
+    header.checksum = cache_checksum(counts, count);
+    header.center_x = state->center_x;
+    header.center_y = state->center_y;
+    header.scale = state->scale;
+
+    // Sized for path, so a long path cannot be truncated into another cache's name
+    char* tmp_path = (char*) malloc(strlen(path) + sizeof(".tmp"));
+    if (!tmp_path) {
+        free(counts);
+        return 0;
+    }
+    sprintf(tmp_path, "%s.tmp", path);
+    FILE* file = fopen(tmp_path, "wb");
+    int ok = file != NULL;
+    if (ok) {
+        ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+             fwrite(counts, sizeof(uint16_t), count, file) == count;
+        ok = (fclose(file) == 0) && ok;
+        ok = ok && rename(tmp_path, path) == 0;
+        if (!ok) remove(tmp_path);
+    }
+
+    free(tmp_path);
+    free(counts);
+    return ok;
+}
+
+// Memory-map a cached buffer and unpack it into iterations
+int mandel_cache_read(const char* path, const MandelbrotState* state, int width, int height,
+                      int* iterations) {
+    const size_t count = (size_t)width * height;
+    const size_t size = sizeof(CacheHeader) + count * sizeof(uint16_t);
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size != size) {
+        close(fd);
+        return 0;
+    }
+
+    void* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return 0;
+
+    const CacheHeader* header = (const CacheHeader*) map;
+    const uint16_t* counts = (const uint16_t*) ((const char*) map + sizeof(CacheHeader));
+    int ok = memcmp(header->magic, CACHE_MAGIC, 4) == 0 &&
+             header->version == CACHE_VERSION &&
+             header->width == (uint32_t) width && header->height == (uint32_t) height &&
+             header->max_iter == MANDEL_MAX_ITER &&
+             header->center_x == state->center_x &&
+             header->center_y == state->center_y &&
+             header->scale == state->scale &&
+             header->checksum == cache_checksum(counts, count);
+
+    if (ok) {
+        for (size_t i = 0; i < count; i++) {
+            iterations[i] = counts[i];
+        }
+    }
+
+    munmap(map, size);
+    return ok;
+}
@@ -0,0 +1,408 @@
+// Level 4: AVX2 + FMA kernels, 4 pixels per __m256d. Built with -mavx2 -mfma;
+// callers check mandel_avx2_ops.supported() before using it.
+#include <immintrin.h>
+#include <math.h>
+#include "mandel_internal.h"
+
+#define MAX_ITER MANDEL_MAX_ITER
+#define ESCAPE_RADIUS MANDEL_ESCAPE_RADIUS
+#define MAX_INTERLEAVE MANDEL_MAX_INTERLEAVE
+
+// z = z^power + c. Every instance has a constant power: z^2 is the Mandelbrot step
+// below, higher powers square and multiply by z along the bits of power.
+static inline __attribute__((always_inline))
+void step_avx2(__m256d* zx, __m256d* zy, __m256d cx, __m256d cy, const int power) {
+    const __m256d two = _mm256_set1_pd(2.0);
+
+    if (power == 2) {
+        __m256d zx2 = _mm256_mul_pd(*zx, *zx);
+        __m256d zy2 = _mm256_mul_pd(*zy, *zy);
+        __m256d xy  = _mm256_mul_pd(*zx, *zy);
+
+        __m256d new_zx = _mm256_sub_pd(zx2, zy2);
+        new_zx = _mm256_add_pd(new_zx, cx);
+
+        __m256d new_zy = _mm256_fmadd_pd(xy, two, cy);
+
+        *zx = new_zx;
+        *zy = new_zy;
+        return;
+    }
+
+    __m256d px = *zx, py = *zy;
+    for (int bit = 30 - __builtin_clz(power); bit >= 0; bit--) {
+        __m256d xy = _mm256_mul_pd(px, py);
+        px = _mm256_fmsub_pd(px, px, _mm256_mul_pd(py, py));
+        py = _mm256_mul_pd(xy, two);
+        if (power & (1 << bit)) {
+            __m256d t = _mm256_fmsub_pd(px, *zx, _mm256_mul_pd(py, *zy));
+            py = _mm256_fmadd_pd(px, *zy, _mm256_mul_pd(py, *zx));
+            px = t;
+        }
+    }
+    *zx = _mm256_add_pd(px, cx);
+    *zy = _mm256_add_pd(py, cy);
+}
+
+// Iterate 4 points at once from z, returns per-lane iteration counts. With smooth,
+// escape_norm receives the |z|^2 each lane escaped with.
+static inline __attribute__((always_inline))
+__m256d iterate_avx2(__m256d zx, __m256d zy, __m256d cx, __m256d cy, const int smooth,
+                     __m256d* escape_norm, const int power) {
+    const __m256d escape_radius = _mm256_set1_pd(ESCAPE_RADIUS * ESCAPE_RADIUS);
+
+    __m256d iter = _mm256_setzero_pd();
+    __m256d active = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    int mask = 0xF;
+
+    for (int i = 0; i < MAX_ITER && mask; i++) {
+        step_avx2(&zx, &zy, cx, cy, power);
+
+        __m256d norm = _mm256_add_pd(_mm256_mul_pd(zx, zx), _mm256_mul_pd(zy, zy));
+        __m256d below = _mm256_cmp_pd(norm, escape_radius, _CMP_LT_OS);
+        int new_mask = _mm256_movemask_pd(below);
+
+        // Escaped lanes keep iterating towards inf, so capture them on the way out
+        if (smooth && new_mask != mask) {
+            *escape_norm = _mm256_blendv_pd(*escape_norm, norm, _mm256_andnot_pd(below, active));
+            active = below;
+        }
+        mask = new_mask;
+
+        __m256d mask_vec = _mm256_castsi256_pd(
+            _mm256_setr_epi64x(
+                (mask & 0x1) ? ~0ULL : 0,
+                (mask & 0x2) ? ~0ULL : 0,
+                (mask & 0x4) ? ~0ULL : 0,
+                (mask & 0x8) ? ~0ULL : 0
+            )
+        );
+        iter = _mm256_add_pd(iter, _mm256_and_pd(_mm256_set1_pd(1.0), mask_vec));
+    }
+
+    return iter;
+}
+
+// Compute one row of iterations. Julia sets start at the pixel with a fixed c.
+static inline __attribute__((always_inline))
+void plain_row_avx2(int* row, float* escape_norm, int y, MandelKernelView* view, const int smooth,
+                    const int julia, const int power) {
+    const __m256d scale = _mm256_set1_pd(view->scale);
+    const __m256d width_half = _mm256_set1_pd(view->half_width);
+    __m256d py = _mm256_set1_pd(view->center_y + (y - view->half_height) * view->scale);
+    __m256d cy = julia ? _mm256_set1_pd(view->julia_y) : py;
+    uint64_t group_steps = 0;
+
+    for (int x = view->x0; x < view->x1; x += 4) {
+        __m256d x_coord = _mm256_set_pd(x+3, x+2, x+1, x);
+        __m256d px = _mm256_add_pd(
+            _mm256_set1_pd(view->center_x),
+            _mm256_mul_pd(_mm256_sub_pd(x_coord, width_half), scale)
+        );
+        __m256d cx = julia ? _mm256_set1_pd(view->julia_x) : px;
+
+        __m256d norm = _mm256_setzero_pd();
+        __m256d iter = iterate_avx2(px, py, cx, cy, smooth, &norm, power);
+
+        double iter_result[4];
+        _mm256_storeu_pd(iter_result, iter);
+        float norm_result[4];
+        if (smooth) _mm_storeu_ps(norm_result, _mm256_cvtpd_ps(norm));
+
+        int steps = 0;
+        for (int k = 0; k < 4 && (x + k) < view->x1; k++) {
+            int count = (int)iter_result[k];
+            row[x + k - view->x0] = count;
+            if (smooth) escape_norm[x + k - view->x0] = norm_result[k];
+            if (count + 1 > steps) steps = count + 1;
+        }
+        group_steps += steps < MAX_ITER ? steps : MAX_ITER;
+    }
+    view->lane_steps += group_steps * 4;
+}
+
+// The capture only exists in the smooth instances, so plain renders keep the original loops
+static void avx2_row(int* row, float* escape_norm, int y, MandelKernelView* view) {
+    if (escape_norm) {
+        plain_row_avx2(row, escape_norm, y, view, 1, 0, 2);
+    } else {
+        plain_row_avx2(row, NULL, y, view, 0, 0, 2);
+    }
+}
+
+// Advance `streams` independent 4-pixel groups per loop step. Each group is its own
+// dependency chain, so the mul/FMA latency of one group is hidden behind the others.
+// A group that finishes is stored and refilled with the next pixels of the row.
+// julia and power select the formula as in plain_row_avx2.
+static inline __attribute__((always_inline))
+void interleaved_row_avx2(int* row, float* escape_norm, int y, MandelKernelView* view,
+                          const int streams, const int smooth, const int julia, const int power) {
+    const __m256d escape_radius = _mm256_set1_pd(ESCAPE_RADIUS * ESCAPE_RADIUS);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d inf = _mm256_set1_pd(INFINITY);
+    const __m256i lane_bits = _mm256_setr_epi64x(1, 2, 4, 8);
+    const __m128i lane_index = _mm_setr_epi32(0, 1, 2, 3);
+    const __m256d scale = _mm256_set1_pd(view->scale);
+    const __m256d width_half = _mm256_set1_pd(view->half_width);
+    const __m256d center_x = _mm256_set1_pd(view->center_x);
+    const __m256d py = _mm256_set1_pd(view->center_y + (y - view->half_height) * view->scale);
+    const __m256d julia_cx = _mm256_set1_pd(view->julia_x);
+    const __m256d cy = julia ? _mm256_set1_pd(view->julia_y) : py;
+    const int x0 = view->x0;
+    const int x1 = view->x1;
+
+    __m256d cx[MAX_INTERLEAVE], zx[MAX_INTERLEAVE], zy[MAX_INTERLEAVE], iter[MAX_INTERLEAVE];
+    // Smooth only: escape |z|^2 per lane. The smooth instances fill escape and iter
+    // only when the lanes of a group change, so the step loop stays as in the plain ones.
+    __m256d escape[MAX_INTERLEAVE];
+    __m256d norm[MAX_INTERLEAVE];       // |z|^2 of the last step
+    __m256d below[MAX_INTERLEAVE];      // Lanes below the escape radius after the last step
+    int captured[MAX_INTERLEAVE];       // Smooth only: lanes below the radius at the last capture
+    int base[MAX_INTERLEAVE];   // First pixel of the group, -1 once the slot is idle
+    int steps[MAX_INTERLEAVE];
+    int mask[MAX_INTERLEAVE];   // Lanes of the group still below the escape radius
+    int next_x = x0;
+    int active = 0;
+    uint64_t executed = 0;
+
+    for (int s = 0; s < streams; s++) {
+        base[s] = -1;
+        cx[s] = zx[s] = zy[s] = iter[s] = _mm256_setzero_pd();
+        escape[s] = inf;
+        steps[s] = 0;
+        mask[s] = captured[s] = 0xF;
+        if (next_x < x1) {
+            __m256d x_coord = _mm256_set_pd(next_x+3, next_x+2, next_x+1, next_x);
+            zx[s] = _mm256_add_pd(center_x, _mm256_mul_pd(_mm256_sub_pd(x_coord, width_half), scale));
+            zy[s] = py;
+            cx[s] = julia ? julia_cx : zx[s];
+            base[s] = next_x;
+            next_x += 4;
+            active++;
+        }
+    }
+
+    while (active) {
+        for (int s = 0; s < streams; s++) {
+            step_avx2(&zx[s], &zy[s], cx[s], cy, power);
+
+            norm[s] = _mm256_add_pd(_mm256_mul_pd(zx[s], zx[s]), _mm256_mul_pd(zy[s], zy[s]));
+            below[s] = _mm256_cmp_pd(norm[s], escape_radius, _CMP_LT_OS);
+            if (!smooth) iter[s] = _mm256_add_pd(iter[s], _mm256_and_pd(one, below[s]));
+            mask[s] = _mm256_movemask_pd(below[s]);
+            steps[s]++;
+
+            // Escaped lanes keep iterating towards inf, so capture |z|^2 and the count
+            // on the way out; only taken when the lanes of the group change
+            if (smooth && mask[s] != captured[s]) {
+                __m256d was_below = _mm256_castsi256_pd(_mm256_cmpeq_epi64(
+                    _mm256_and_si256(_mm256_set1_epi64x(captured[s]), lane_bits), lane_bits));
+                __m256d escaped = _mm256_andnot_pd(below[s], was_below);
+                escape[s] = _mm256_blendv_pd(escape[s], norm[s], escaped);
+                iter[s] = _mm256_blendv_pd(iter[s], _mm256_set1_pd(steps[s] - 1), escaped);
+                captured[s] = mask[s];
+            }
+        }
+
+        // Per-group exit: store finished groups and refill their slot
+        for (int s = 0; s < streams; s++) {
+            if (base[s] < 0 || (mask[s] && steps[s] < MAX_ITER)) continue;
+
+            // Masked stores keep the row tail past x1 untouched
+            __m128i store = _mm_cmpgt_epi32(_mm_set1_epi32(x1 - base[s]), lane_index);
+            __m256d counts = iter[s];
+            if (smooth) counts = _mm256_blendv_pd(iter[s], _mm256_set1_pd(steps[s]), below[s]);
+            _mm_maskstore_epi32(row + base[s] - x0, store, _mm256_cvttpd_epi32(counts));
+            if (smooth) {
+                _mm_maskstore_ps(escape_norm + base[s] - x0, store, _mm256_cvtpd_ps(escape[s]));
+            }
+            executed += steps[s];
+
+            if (next_x < x1) {
+                __m256d x_coord = _mm256_set_pd(next_x+3, next_x+2, next_x+1, next_x);
+                zx[s] = _mm256_add_pd(center_x, _mm256_mul_pd(_mm256_sub_pd(x_coord, width_half), scale));
+                zy[s] = py;
+                cx[s] = julia ? julia_cx : zx[s];
+                iter[s] = _mm256_setzero_pd();
+                escape[s] = inf;
+                steps[s] = 0;
+                mask[s] = captured[s] = 0xF;
+                base[s] = next_x;
+                next_x += 4;
+            } else {
+                // Idle slots keep iterating until the row is done but are never stored
+                cx[s] = zx[s] = zy[s] = _mm256_setzero_pd();
+                base[s] = -1;
+                active--;
+            }
+        }
+    }
+
+    view->lane_steps += executed * 4;
+}
+
+// Interleaved kernel instances; the constant stream count lets the compiler unroll the groups
+#define AVX2_INTERLEAVED(name, streams, julia, power) \
+    static void name(int* row, float* escape_norm, int y, MandelKernelView* view) { \
+        if (escape_norm) interleaved_row_avx2(row, escape_norm, y, view, streams, 1, julia, power); \
+        else interleaved_row_avx2(row, NULL, y, view, streams, 0, julia, power); \
+    }
+
+AVX2_INTERLEAVED(avx2_row_x2, 2, 0, 2)
+AVX2_INTERLEAVED(avx2_row_x3, 3, 0, 2)
+AVX2_INTERLEAVED(avx2_row_x4, 4, 0, 2)
+
+// Iterate arbitrary points with the plain kernel, 4 at a time
+static inline __attribute__((always_inline))
+void plain_points_avx2(const double* px, const double* py, int count, int* iterations,
+                       float* escape_norm, MandelKernelView* view, const int julia, const int power) {
+    uint64_t group_steps = 0;
+    for (int j = 0; j < count; j += 4) {
+        double sx[4], sy[4];
+        for (int k = 0; k < 4; k++) {
+            int i = j + k < count ? j + k : j;
+            sx[k] = view->center_x + (px[i] - view->half_width) * view->scale;
+            sy[k] = view->center_y + (py[i] - view->half_height) * view->scale;
+        }
+
+        __m256d zx = _mm256_loadu_pd(sx);
+        __m256d zy = _mm256_loadu_pd(sy);
+        __m256d cx = julia ? _mm256_set1_pd(view->julia_x) : zx;
+        __m256d cy = julia ? _mm256_set1_pd(view->julia_y) : zy;
+        __m256d norm = _mm256_setzero_pd();
+        double iter_result[4];
+        _mm256_storeu_pd(iter_result, iterate_avx2(zx, zy, cx, cy, escape_norm != NULL, &norm, power));
+        float norm_result[4];
+        _mm_storeu_ps(norm_result, _mm256_cvtpd_ps(norm));
+        int steps = 0;
+        for (int k = 0; k < 4 && j + k < count; k++) {
+            iterations[j + k] = (int)iter_result[k];
+            if (escape_norm) escape_norm[j + k] = norm_result[k];
+            if (iterations[j + k] + 1 > steps) steps = iterations[j + k] + 1;
+        }
+        group_steps += steps < MAX_ITER ? steps : MAX_ITER;
+    }
+    view->lane_steps += group_steps * 4;
+}
+
+static void avx2_points(const double* px, const double* py, int count,
+                        int* iterations, float* escape_norm, MandelKernelView* view) {
+    plain_points_avx2(px, py, count, iterations, escape_norm, view, 0, 2);
+}
+
+// Instances of the other formulas, picked at runtime from avx2_formulas
+#define AVX2_FORMULA(julia, power) \
+    static void avx2_row_##julia##_##power(int* row, float* escape_norm, int y, MandelKernelView* view) { \
+        if (escape_norm) plain_row_avx2(row, escape_norm, y, view, 1, julia, power); \
+        else plain_row_avx2(row, NULL, y, view, 0, julia, power); \
+    } \
+    static void avx2_points_##julia##_##power(const double* px, const double* py, int count, \
+                                              int* iterations, float* escape_norm, MandelKernelView* view) { \
+        plain_points_avx2(px, py, count, iterations, escape_norm, view, julia, power); \
+    } \
+    AVX2_INTERLEAVED(avx2_row_##julia##_##power##_x2, 2, julia, power) \
+    AVX2_INTERLEAVED(avx2_row_##julia##_##power##_x3, 3, julia, power) \
+    AVX2_INTERLEAVED(avx2_row_##julia##_##power##_x4, 4, julia, power)
+
+AVX2_FORMULA(0, 3) AVX2_FORMULA(0, 4) AVX2_FORMULA(0, 5) AVX2_FORMULA(0, 6)
+AVX2_FORMULA(0, 7) AVX2_FORMULA(0, 8)
+AVX2_FORMULA(1, 2) AVX2_FORMULA(1, 3) AVX2_FORMULA(1, 4) AVX2_FORMULA(1, 5)
+AVX2_FORMULA(1, 6) AVX2_FORMULA(1, 7) AVX2_FORMULA(1, 8)
+
+#define AVX2_ENTRY(julia, power) \
+    {{avx2_row_##julia##_##power, avx2_row_##julia##_##power##_x2, avx2_row_##julia##_##power##_x3, \
+      avx2_row_##julia##_##power##_x4}, avx2_points_##julia##_##power}
+
+// [fractal][power - 2], covering powers 2..MANDEL_MAX_POWER
+static const MandelFormulaKernels avx2_formulas[MANDEL_FRACTAL_COUNT][MANDEL_POWER_COUNT] = {
+    {{{avx2_row, avx2_row_x2, avx2_row_x3, avx2_row_x4}, avx2_points}, AVX2_ENTRY(0, 3), AVX2_ENTRY(0, 4), AVX2_ENTRY(0, 5),
+     AVX2_ENTRY(0, 6), AVX2_ENTRY(0, 7), AVX2_ENTRY(0, 8)},
+    {AVX2_ENTRY(1, 2), AVX2_ENTRY(1, 3), AVX2_ENTRY(1, 4), AVX2_ENTRY(1, 5),
+     AVX2_ENTRY(1, 6), AVX2_ENTRY(1, 7), AVX2_ENTRY(1, 8)}
+};
+
+// Iterate 4 points while tracking the derivative dz/dc. z and dz of each lane are
+// captured on the step it escapes, so distance receives the exterior distance
+// estimate 2|z|ln|z|/|dz| for escaped lanes and 0 for lanes that reached MAX_ITER
+static void avx2_de_group(int x, int y, int iterations[4], double distance[4],
+                          float escape_norm[4], MandelKernelView* view) {
+    const __m256d escape_radius = _mm256_set1_pd(ESCAPE_RADIUS * ESCAPE_RADIUS);
+    const __m256d two = _mm256_set1_pd(2.0);
+    const __m256d one = _mm256_set1_pd(1.0);
+
+    __m256d x_coord = _mm256_set_pd(x+3, x+2, x+1, x);
+    __m256d cx = _mm256_add_pd(
+        _mm256_set1_pd(view->center_x),
+        _mm256_mul_pd(_mm256_sub_pd(x_coord, _mm256_set1_pd(view->half_width)),
+                      _mm256_set1_pd(view->scale))
+    );
+    __m256d cy = _mm256_set1_pd(view->center_y + (y - view->half_height) * view->scale);
+
+    __m256d zx = cx, zy = cy;
+    __m256d dzx = one, dzy = _mm256_setzero_pd();  // z_1 = c, so dz_1 = 1
+    __m256d ezx = zx, ezy = zy, edzx = dzx, edzy = dzy;
+    __m256d iter = _mm256_setzero_pd();
+    __m256d active = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    int mask = 0xF;
+    int i = 0;
+
+    for (; i < MAX_ITER && mask; i++) {
+        __m256d zx2 = _mm256_mul_pd(zx, zx);
+        __m256d zy2 = _mm256_mul_pd(zy, zy);
+        __m256d xy  = _mm256_mul_pd(zx, zy);
+
+        // dz' = 2 * z * dz + 1
+        __m256d new_dzx = _mm256_fmadd_pd(two, _mm256_fmsub_pd(zx, dzx, _mm256_mul_pd(zy, dzy)), one);
+        dzy = _mm256_mul_pd(two, _mm256_fmadd_pd(zx, dzy, _mm256_mul_pd(zy, dzx)));
+        dzx = new_dzx;
+        zx = _mm256_add_pd(_mm256_sub_pd(zx2, zy2), cx);
+        zy = _mm256_fmadd_pd(xy, two, cy);
+
+        __m256d norm = _mm256_add_pd(_mm256_mul_pd(zx, zx), _mm256_mul_pd(zy, zy));
+        __m256d below = _mm256_cmp_pd(norm, escape_radius, _CMP_LT_OS);
+        iter = _mm256_add_pd(iter, _mm256_and_pd(one, below));
+
+        // Escaped lanes keep iterating towards inf/NaN, so capture them on the way out
+        int new_mask = _mm256_movemask_pd(below);
+        if (new_mask != mask) {
+            __m256d escaped = _mm256_andnot_pd(below, active);
+            ezx  = _mm256_blendv_pd(ezx, zx, escaped);
+            ezy  = _mm256_blendv_pd(ezy, zy, escaped);
+            edzx = _mm256_blendv_pd(edzx, dzx, escaped);
+            edzy = _mm256_blendv_pd(edzy, dzy, escaped);
+            active = below;
+            mask = new_mask;
+        }
+    }
+
+    double zx_result[4], zy_result[4], dzx_result[4], dzy_result[4], iter_result[4];
+    _mm256_storeu_pd(zx_result, ezx);
+    _mm256_storeu_pd(zy_result, ezy);
+    _mm256_storeu_pd(dzx_result, edzx);
+    _mm256_storeu_pd(dzy_result, edzy);
+    _mm256_storeu_pd(iter_result, iter);
+
+    for (int k = 0; k < 4; k++) {
+        double norm = zx_result[k] * zx_result[k] + zy_result[k] * zy_result[k];
+        double dnorm = dzx_result[k] * dzx_result[k] + dzy_result[k] * dzy_result[k];
+        distance[k] = !(mask & (1 << k)) && dnorm > 0 ? sqrt(norm / dnorm) * log(norm) : 0.0;
+        iterations[k] = (int)iter_result[k];
+        if (escape_norm) escape_norm[k] = (float)norm;
+    }
+
+    view->de_lane_steps += (uint64_t)i * 4;
+}
+
+static int avx2_supported(void) {
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+
+const MandelKernelOps mandel_avx2_ops = {
+    "avx2",
+    {avx2_row, avx2_row_x2, avx2_row_x3, avx2_row_x4},
+    avx2_points,
+    avx2_de_group,
+    1,
+    avx2_formulas,
+    avx2_supported
+};
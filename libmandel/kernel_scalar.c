@@ -0,0 +1,129 @@
+// Levels 1 and 2: scalar kernels, built without SIMD flags
+#include "mandel_internal.h"
+
+#define MAX_ITER MANDEL_MAX_ITER
+#define ESCAPE_RADIUS MANDEL_ESCAPE_RADIUS
+
+// Iterate one point, z starts at c
+static inline int iterate_scalar(double cx, double cy) {
+    double zx = cx;
+    double zy = cy;
+    int iter = 0;
+
+    while (iter < MAX_ITER) {
+        double zx2 = zx * zx;
+        double zy2 = zy * zy;
+        if (zx2 + zy2 > ESCAPE_RADIUS * ESCAPE_RADIUS) break;
+        zy = 2 * zx * zy + cy;
+        zx = zx2 - zy2 + cx;
+        iter++;
+    }
+    return iter;
+}
+
+static void scalar_row(int* row, float* escape_norm, int y, MandelKernelView* view) {
+    (void) escape_norm;     // No smooth coloring at levels 1 and 2
+    double cy = view->center_y + (y - view->half_height) * view->scale;
+    uint64_t steps = 0;
+
+    for (int x = view->x0; x < view->x1; x++) {
+        double cx = view->center_x + (x - view->half_width) * view->scale;
+        int iter = iterate_scalar(cx, cy);
+        row[x - view->x0] = iter;
+        steps += iter < MAX_ITER ? iter + 1 : MAX_ITER;
+    }
+    view->lane_steps += steps;
+}
+
+static void scalar_points(const double* px, const double* py, int count,
+                          int* iterations, float* escape_norm, MandelKernelView* view) {
+    (void) escape_norm;
+    uint64_t steps = 0;
+    for (int j = 0; j < count; j++) {
+        double cx = view->center_x + (px[j] - view->half_width) * view->scale;
+        double cy = view->center_y + (py[j] - view->half_height) * view->scale;
+        iterations[j] = iterate_scalar(cx, cy);
+        steps += iterations[j] < MAX_ITER ? iterations[j] + 1 : MAX_ITER;
+    }
+    view->lane_steps += steps;
+}
+
+// Iterate 4 points with scalar ops and a bitmask early exit. z starts at 0 and a
+// lane records the step it escaped on; lanes that never escape keep 0.
+static inline int iterate_unroll4(const double cx[4], const double cy[4], int iter[4]) {
+    double zx[4] = {0}, zy[4] = {0};
+    int mask = 0;
+    int i;
+
+    for (int k = 0; k < 4; k++) iter[k] = 0;
+
+    for (i = 0; i < MAX_ITER && mask != 0x0F; i++) {
+        for (int k = 0; k < 4; k++) {
+            if (mask & (1 << k)) continue;
+
+            double zx2 = zx[k] * zx[k];
+            double zy2 = zy[k] * zy[k];
+            double zxzy = 2 * zx[k] * zy[k];
+
+            zx[k] = zx2 - zy2 + cx[k];
+            zy[k] = zxzy + cy[k];
+
+            if (zx2 + zy2 > ESCAPE_RADIUS * ESCAPE_RADIUS) {
+                mask |= (1 << k);
+                iter[k] = i;
+            }
+        }
+    }
+    return i;
+}
+
+static void unroll4_row(int* row, float* escape_norm, int y, MandelKernelView* view) {
+    (void) escape_norm;
+    double cy = view->center_y + (y - view->half_height) * view->scale;
+    const double cys[4] = {cy, cy, cy, cy};
+    uint64_t steps = 0;
+
+    for (int x = view->x0; x < view->x1; x += 4) {
+        double cx[4];
+        for (int k = 0; k < 4; k++) {
+            cx[k] = view->center_x + (x + k - view->half_width) * view->scale;
+        }
+
+        int iter[4];
+        steps += iterate_unroll4(cx, cys, iter);
+
+        for (int k = 0; k < 4 && (x + k) < view->x1; k++) {
+            row[x + k - view->x0] = iter[k];
+        }
+    }
+    view->lane_steps += steps * 4;
+}
+
+static void unroll4_points(const double* px, const double* py, int count,
+                           int* iterations, float* escape_norm, MandelKernelView* view) {
+    (void) escape_norm;
+    uint64_t steps = 0;
+    for (int j = 0; j < count; j += 4) {
+        double cx[4], cy[4];
+        int iter[4];
+        for (int k = 0; k < 4; k++) {
+            int i = j + k < count ? j + k : j;
+            cx[k] = view->center_x + (px[i] - view->half_width) * view->scale;
+            cy[k] = view->center_y + (py[i] - view->half_height) * view->scale;
+        }
+
+        steps += iterate_unroll4(cx, cy, iter);
+        for (int k = 0; k < 4 && j + k < count; k++) {
+            iterations[j + k] = iter[k];
+        }
+    }
+    view->lane_steps += steps * 4;
+}
+
+const MandelKernelOps mandel_scalar_ops = {
+    "scalar", {scalar_row}, scalar_points, NULL, 0, NULL, NULL
+};
+
+const MandelKernelOps mandel_unroll4_ops = {
+    "unroll4", {unroll4_row}, unroll4_points, NULL, 0, NULL, NULL
+};
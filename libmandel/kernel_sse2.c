@@ -0,0 +1,197 @@
+// Level 3: SSE2 kernel, 2 pixels per __m128d
+#include <emmintrin.h>
+#include "mandel_internal.h"
+
+#define MAX_ITER MANDEL_MAX_ITER
+#define ESCAPE_RADIUS MANDEL_ESCAPE_RADIUS
+
+// z = z^power + c, returns |z|^2 of the z it started from. Every instance has a
+// constant power: z^2 is the Mandelbrot step below, higher powers square and
+// multiply by z along the bits of power.
+static inline __attribute__((always_inline))
+__m128d step_sse2(__m128d* zx, __m128d* zy, __m128d cx, __m128d cy, const int power) {
+    __m128d two = _mm_set1_pd(2.0);
+    __m128d zx2 = _mm_mul_pd(*zx, *zx);
+    __m128d zy2 = _mm_mul_pd(*zy, *zy);
+
+    if (power == 2) {
+        __m128d zxzy = _mm_mul_pd(_mm_mul_pd(*zx, *zy), two);
+
+        *zx = _mm_add_pd(_mm_sub_pd(zx2, zy2), cx);
+        *zy = _mm_add_pd(zxzy, cy);
+        return _mm_add_pd(zx2, zy2);
+    }
+
+    // The first squaring reuses zx2 and zy2
+    __m128d px = _mm_sub_pd(zx2, zy2);
+    __m128d py = _mm_mul_pd(_mm_mul_pd(*zx, *zy), two);
+    if (power & (1 << (30 - __builtin_clz(power)))) {
+        __m128d t = _mm_sub_pd(_mm_mul_pd(px, *zx), _mm_mul_pd(py, *zy));
+        py = _mm_add_pd(_mm_mul_pd(px, *zy), _mm_mul_pd(py, *zx));
+        px = t;
+    }
+    for (int bit = 29 - __builtin_clz(power); bit >= 0; bit--) {
+        __m128d xy = _mm_mul_pd(px, py);
+        px = _mm_sub_pd(_mm_mul_pd(px, px), _mm_mul_pd(py, py));
+        py = _mm_mul_pd(xy, two);
+        if (power & (1 << bit)) {
+            __m128d t = _mm_sub_pd(_mm_mul_pd(px, *zx), _mm_mul_pd(py, *zy));
+            py = _mm_add_pd(_mm_mul_pd(px, *zy), _mm_mul_pd(py, *zx));
+            px = t;
+        }
+    }
+    *zx = _mm_add_pd(px, cx);
+    *zy = _mm_add_pd(py, cy);
+    return _mm_add_pd(zx2, zy2);
+}
+
+// Iterate 2 points at once from z, returns per-lane iteration counts in the low 32 bits
+// of each lane. With smooth, escape_norm receives the |z|^2 each lane escaped with.
+static inline __attribute__((always_inline))
+__m128i iterate_sse2(__m128d zx, __m128d zy, __m128d cx, __m128d cy, int* steps, const int smooth,
+                     __m128d* escape_norm, const int power) {
+    __m128d escape_radius = _mm_set1_pd(ESCAPE_RADIUS * ESCAPE_RADIUS);
+
+    __m128i iter = _mm_setzero_si128();
+    __m128i one = _mm_set1_epi64x(1);
+    int mask = 3;
+    __m128d active = _mm_castsi128_pd(_mm_set1_epi64x(-1));
+    int i;
+
+    for (i = 0; i < MAX_ITER && mask; i++) {
+        __m128d norm = step_sse2(&zx, &zy, cx, cy, power);
+        __m128d cmp = _mm_cmplt_pd(norm, escape_radius);
+        int new_mask = _mm_movemask_pd(cmp);
+
+        // Escaped lanes keep iterating towards inf, so capture them on the way out
+        if (smooth && new_mask != mask) {
+            __m128d escaped = _mm_andnot_pd(cmp, active);
+            *escape_norm = _mm_or_pd(_mm_and_pd(escaped, norm), _mm_andnot_pd(escaped, *escape_norm));
+            active = cmp;
+        }
+        mask = new_mask;
+
+        __m128i inc = _mm_castpd_si128(cmp);
+        iter = _mm_add_epi64(iter, _mm_and_si128(inc, one));
+    }
+
+    *steps = i;
+    return iter;
+}
+
+// Julia sets start at the pixel with a fixed c
+static inline __attribute__((always_inline))
+void plain_row_sse2(int* row, float* escape_norm, int y, MandelKernelView* view, const int smooth,
+                    const int julia, const int power) {
+    __m128d scale = _mm_set1_pd(view->scale);
+    __m128d center_x = _mm_set1_pd(view->center_x);
+    __m128d width_half = _mm_set1_pd(view->half_width);
+    __m128d py = _mm_set1_pd(view->center_y + (y - view->half_height) * view->scale);
+    __m128d cy = julia ? _mm_set1_pd(view->julia_y) : py;
+    uint64_t steps = 0;
+
+    for (int x = view->x0; x < view->x1; x += 2) {
+        __m128d x_coord = _mm_set_pd(x + 1, x);
+        __m128d px = _mm_add_pd(center_x,
+                      _mm_mul_pd(_mm_sub_pd(x_coord, width_half), scale));
+        __m128d cx = julia ? _mm_set1_pd(view->julia_x) : px;
+
+        int group_steps;
+        __m128d norm = _mm_setzero_pd();
+        __m128i iter = iterate_sse2(px, py, cx, cy, &group_steps, smooth, &norm, power);
+        steps += group_steps;
+
+        // 64-bit lanes: the counts sit in elements 0 and 2 of the int view
+        int iter_result[4];
+        _mm_storeu_si128((__m128i*)iter_result, iter);
+
+        row[x - view->x0] = iter_result[0];
+        if (x + 1 < view->x1) {
+            row[x + 1 - view->x0] = iter_result[2];
+        }
+
+        if (smooth) {
+            double norm_result[2];
+            _mm_storeu_pd(norm_result, norm);
+            escape_norm[x - view->x0] = (float)norm_result[0];
+            if (x + 1 < view->x1) escape_norm[x + 1 - view->x0] = (float)norm_result[1];
+        }
+    }
+    view->lane_steps += steps * 2;
+}
+
+// The capture only exists in the smooth instance, so plain renders keep the original loop
+static void sse2_row(int* row, float* escape_norm, int y, MandelKernelView* view) {
+    if (escape_norm) {
+        plain_row_sse2(row, escape_norm, y, view, 1, 0, 2);
+    } else {
+        plain_row_sse2(row, NULL, y, view, 0, 0, 2);
+    }
+}
+
+static inline __attribute__((always_inline))
+void plain_points_sse2(const double* px, const double* py, int count, int* iterations,
+                       float* escape_norm, MandelKernelView* view, const int julia, const int power) {
+    uint64_t group_steps = 0;
+    for (int j = 0; j < count; j += 2) {
+        int i = j + 1 < count ? j + 1 : j;
+        __m128d zx = _mm_set_pd(view->center_x + (px[i] - view->half_width) * view->scale,
+                                view->center_x + (px[j] - view->half_width) * view->scale);
+        __m128d zy = _mm_set_pd(view->center_y + (py[i] - view->half_height) * view->scale,
+                                view->center_y + (py[j] - view->half_height) * view->scale);
+        __m128d cx = julia ? _mm_set1_pd(view->julia_x) : zx;
+        __m128d cy = julia ? _mm_set1_pd(view->julia_y) : zy;
+
+        int steps;
+        int iter_result[4];
+        __m128d norm = _mm_setzero_pd();
+        _mm_storeu_si128((__m128i*)iter_result,
+                         iterate_sse2(zx, zy, cx, cy, &steps, escape_norm != NULL, &norm, power));
+        group_steps += steps;
+        iterations[j] = iter_result[0];
+        if (j + 1 < count) iterations[j + 1] = iter_result[2];
+
+        if (escape_norm) {
+            double norm_result[2];
+            _mm_storeu_pd(norm_result, norm);
+            escape_norm[j] = (float)norm_result[0];
+            if (j + 1 < count) escape_norm[j + 1] = (float)norm_result[1];
+        }
+    }
+    view->lane_steps += group_steps * 2;
+}
+
+static void sse2_points(const double* px, const double* py, int count,
+                        int* iterations, float* escape_norm, MandelKernelView* view) {
+    plain_points_sse2(px, py, count, iterations, escape_norm, view, 0, 2);
+}
+
+// Instances of the other formulas, picked at runtime from sse2_formulas
+#define SSE2_FORMULA(julia, power) \
+    static void sse2_row_##julia##_##power(int* row, float* escape_norm, int y, MandelKernelView* view) { \
+        if (escape_norm) plain_row_sse2(row, escape_norm, y, view, 1, julia, power); \
+        else plain_row_sse2(row, NULL, y, view, 0, julia, power); \
+    } \
+    static void sse2_points_##julia##_##power(const double* px, const double* py, int count, \
+                                              int* iterations, float* escape_norm, MandelKernelView* view) { \
+        plain_points_sse2(px, py, count, iterations, escape_norm, view, julia, power); \
+    }
+
+SSE2_FORMULA(0, 3) SSE2_FORMULA(0, 4) SSE2_FORMULA(0, 5) SSE2_FORMULA(0, 6)
+SSE2_FORMULA(0, 7) SSE2_FORMULA(0, 8)
+SSE2_FORMULA(1, 2) SSE2_FORMULA(1, 3) SSE2_FORMULA(1, 4) SSE2_FORMULA(1, 5)
+SSE2_FORMULA(1, 6) SSE2_FORMULA(1, 7) SSE2_FORMULA(1, 8)
+
+#define SSE2_ENTRY(julia, power) {{sse2_row_##julia##_##power}, sse2_points_##julia##_##power}
+
+// [fractal][power - 2], covering powers 2..MANDEL_MAX_POWER
+static const MandelFormulaKernels sse2_formulas[MANDEL_FRACTAL_COUNT][MANDEL_POWER_COUNT] = {
+    {{{sse2_row}, sse2_points}, SSE2_ENTRY(0, 3), SSE2_ENTRY(0, 4), SSE2_ENTRY(0, 5),
+     SSE2_ENTRY(0, 6), SSE2_ENTRY(0, 7), SSE2_ENTRY(0, 8)},
+    {SSE2_ENTRY(1, 2), SSE2_ENTRY(1, 3), SSE2_ENTRY(1, 4), SSE2_ENTRY(1, 5),
+     SSE2_ENTRY(1, 6), SSE2_ENTRY(1, 7), SSE2_ENTRY(1, 8)}
+};
+
+const MandelKernelOps mandel_sse2_ops = {
+    "sse2", {sse2_row}, sse2_points, NULL, 1, sse2_formulas, NULL
+};
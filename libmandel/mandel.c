@@ -0,0 +1,780 @@
+// Render driver: options, scratch buffers, the row driver and the per-frame passes
+// (symmetry, adaptive AA, distance estimation, coloring). Kernels live in kernel_*.c.
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <x86intrin.h>  // For __rdtsc
+#include "mandel_internal.h"
+
+#define MAX_ITER MANDEL_MAX_ITER
+#define AA_SAMPLES MANDEL_AA_SAMPLES
+#define SYMMETRY_EPS 1e-6   // Max row misalignment (in pixels) for real-axis mirroring
+#define DE_MAX_RADIUS 64    // Cap (pixels) on the exterior disk filled from one sample
+#define DE_EXACT_CHUNK 64   // Skipped pixels recomputed per kernel call
+#define PALETTE_STEPS 16    // Smooth palette entries per iteration
+#define PALETTE_SIZE (MAX_ITER * PALETTE_STEPS)
+
+enum { PIXEL_PENDING, PIXEL_COMPUTED, PIXEL_SKIPPED, PIXEL_FILLED };  // FILLED: skipped, interpolated
+
+// Scratch buffers, kept between renders so repeated renders do not allocate
+enum {
+    SCRATCH_ITERATIONS,     // Counts when the caller only wants RGBA
+    SCRATCH_EDGES,
+    SCRATCH_HALO,           // Counts of the pixels around the region, for AA edges
+    SCRATCH_SAMPLES,
+    SCRATCH_COORDS,
+    SCRATCH_FILL,
+    SCRATCH_SUM,
+    SCRATCH_WEIGHT,
+    SCRATCH_EXACT,
+    SCRATCH_ESCAPE,         // Escape |z|^2 of the region for smooth coloring
+    SCRATCH_SAMPLE_ESCAPE,
+    SCRATCH_COUNT
+};
+
+struct MandelContext {
+    MandelOptions options;
+    const MandelKernelOps* ops;
+    mandel_row_fn row;          // Kernels of the selected formula and interleave
+    mandel_points_fn points;
+    struct {
+        void* data;
+        size_t size;
+    } scratch[SCRATCH_COUNT];
+    uint32_t palette[PALETTE_SIZE + 1];  // Smooth coloring RGBA8, the last entry is the set
+};
+
+// One render: the region being computed and where its counts go
+typedef struct {
+    const MandelbrotState* state;
+    int width, height;
+    MandelRect rect;
+    int* iterations;        // Region counts, row y - rect.y0 at iterations + (y - rect.y0) * stride
+    size_t stride;
+    float* escape;          // Escape |z|^2 with stride rect width, NULL unless smooth coloring
+    const uint32_t* palette;
+    float inv_log2_power;   // 1 / log2(power) for the smooth count of z^power + c
+    MandelKernelView view;
+} Frame;
+
+// Distance-estimator pass of one render, computed row by row by de_row and finished
+// band by band by de_finish_rows
+typedef struct {
+    unsigned char* fill;    // PIXEL_* per region pixel, stride rect width
+    int* exact;             // Skipped pixels of the band left to the plain kernel
+    float* sum;             // MANDEL_DE_INTERPOLATE only: weighted neighbor counts
+    unsigned char* weight;
+    int interpolate;
+    int finished;           // Rows above are final
+    int skipped;
+} DeState;
+
+static const MandelKernelOps* const kernel_ops[] = {
+    &mandel_scalar_ops, &mandel_unroll4_ops, &mandel_sse2_ops, &mandel_avx2_ops
+};
+
+// Grow a scratch buffer to at least size bytes; contents are not preserved
+static void* scratch(MandelContext* ctx, int slot, size_t size) {
+    if (size == 0) size = 1;
+    if (ctx->scratch[slot].size < size) {
+        free(ctx->scratch[slot].data);
+        ctx->scratch[slot].data = malloc(size);
+        ctx->scratch[slot].size = ctx->scratch[slot].data ? size : 0;
+    }
+    return ctx->scratch[slot].data;
+}
+
+// CPU time of the calling thread, so concurrent renders do not count each other
+static double thread_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static inline int* frame_row(const Frame* f, int y) {
+    return f->iterations + (size_t)(y - f->rect.y0) * f->stride;
+}
+
+static inline float* frame_escape(const Frame* f, int y) {
+    return f->escape ? f->escape + (size_t)(y - f->rect.y0) * (f->rect.x1 - f->rect.x0) : NULL;
+}
+
+// Palette position t = iterations / MAX_ITER in [0, 1) to color
+static inline void color_at(float t, uint8_t* rgb) {
+    rgb[0] = (uint8_t)(9 * (1-t) * t*t*t * 255);           // Red component
+    rgb[1] = (uint8_t)(15 * (1-t)*(1-t) * t*t * 255);      // Green component
+    rgb[2] = (uint8_t)(8.5 * (1-t)*(1-t)*(1-t) * t * 255); // Blue component
+}
+
+// Convert iteration count to color
+static inline void get_color(int iterations, uint8_t* rgb) {
+    if (iterations == MAX_ITER) {
+        rgb[0] = rgb[1] = rgb[2] = 0;
+        return;
+    }
+    color_at((float)iterations / MAX_ITER, rgb);
+}
+
+// Entry i holds the color of i / PALETTE_STEPS iterations, so whole counts match get_color
+static void build_palette(uint32_t* palette) {
+    for (int i = 0; i <= PALETTE_SIZE; i++) {
+        uint8_t rgba[4] = {0, 0, 0, 255};
+        if (i < PALETTE_SIZE) color_at((float)i / PALETTE_SIZE, rgba);
+        memcpy(&palette[i], rgba, 4);
+    }
+}
+
+// log2 of 4 positive floats: the exponent plus a cubic in the mantissa that is exact at
+// both ends of [1, 2), so the result stays continuous and monotonic (error < 1.5e-4)
+static inline __m128 fast_log2(__m128 x) {
+    __m128i bits = _mm_castps_si128(x);
+    __m128 exponent = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127)));
+    __m128 u = _mm_sub_ps(_mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007FFFFF)),
+                                                        _mm_set1_epi32(0x3F800000))),
+                          _mm_set1_ps(1.0f));
+
+    __m128 p = _mm_set1_ps(-0.08030730f);
+    p = _mm_add_ps(_mm_mul_ps(p, u), _mm_set1_ps(0.31700072f));
+    p = _mm_add_ps(_mm_mul_ps(p, u), _mm_set1_ps(-0.67476666f));
+    p = _mm_add_ps(_mm_mul_ps(p, u), _mm_set1_ps(1.43807325f));
+    return _mm_add_ps(exponent, _mm_mul_ps(p, u));
+}
+
+// Palette indices of 4 pixels. A pixel that escaped after n iterations with R <= |z| < R^d
+// has the normalized count mu = n + 1 - log_d(ln|z| / ln R) in (n, n + 1], which is
+// continuous where n changes, so the colors have no bands. d is the power of the formula.
+static inline __m128i smooth_index(__m128i counts, __m128 escape_norm, float inv_log2_power) {
+    const __m128 inv_log2_radius = _mm_set1_ps(
+        (float)(1.0 / log2(MANDEL_ESCAPE_RADIUS * MANDEL_ESCAPE_RADIUS)));
+
+    __m128 ratio = _mm_mul_ps(fast_log2(escape_norm), inv_log2_radius);   // ln|z| / ln R
+    __m128 mu = _mm_sub_ps(_mm_add_ps(_mm_cvtepi32_ps(counts), _mm_set1_ps(1.0f)),
+                           _mm_mul_ps(fast_log2(ratio), _mm_set1_ps(inv_log2_power)));
+
+    // Clamp before converting; max returns 0 for the NaN of pixels that never escaped
+    __m128 pos = _mm_max_ps(_mm_mul_ps(mu, _mm_set1_ps(PALETTE_STEPS)), _mm_setzero_ps());
+    __m128i index = _mm_cvttps_epi32(_mm_min_ps(pos, _mm_set1_ps(PALETTE_SIZE - 1)));
+
+    __m128i inside = _mm_cmpgt_epi32(counts, _mm_set1_epi32(MAX_ITER - 1));
+    return _mm_or_si128(_mm_andnot_si128(inside, index),
+                        _mm_and_si128(inside, _mm_set1_epi32(PALETTE_SIZE)));
+}
+
+void mandel_colorize(const int* iterations, size_t iter_stride, int width, int height,
+                     uint8_t* rgba, size_t rgba_stride) {
+    for (int y = 0; y < height; y++) {
+        const int* row = iterations + y * iter_stride;
+        uint8_t* out = rgba + y * rgba_stride;
+        for (int x = 0; x < width; x++) {
+            get_color(row[x], out + 4*x);
+            out[4*x + 3] = 255;
+        }
+    }
+}
+
+// Smooth-colorize rows [y0, y1) of the region, 4 pixels per step
+static void colorize_smooth_rows(const Frame* f, uint8_t* rgba, size_t rgba_stride, int y0, int y1) {
+    int w = f->rect.x1 - f->rect.x0;
+
+    for (int y = y0; y < y1; y++) {
+        const int* row = frame_row(f, y);
+        const float* norm = frame_escape(f, y);
+        uint8_t* out = rgba + (size_t)(y - f->rect.y0) * rgba_stride;
+
+        for (int x = 0; x < w; x += 4) {
+            int index[4];
+            if (x + 4 <= w) {
+                _mm_storeu_si128((__m128i*)index, smooth_index(_mm_loadu_si128((const __m128i*)(row + x)),
+                                                               _mm_loadu_ps(norm + x), f->inv_log2_power));
+            } else {
+                int counts[4] = {MAX_ITER, MAX_ITER, MAX_ITER, MAX_ITER};
+                float tail[4] = {0};
+                memcpy(counts, row + x, (w - x) * sizeof(int));
+                memcpy(tail, norm + x, (w - x) * sizeof(float));
+                _mm_storeu_si128((__m128i*)index, smooth_index(_mm_loadu_si128((const __m128i*)counts),
+                                                               _mm_loadu_ps(tail), f->inv_log2_power));
+            }
+
+            for (int k = 0; k < 4 && x + k < w; k++) {
+                memcpy(out + 4*(x + k), &f->palette[index[k]], 4);
+            }
+        }
+    }
+}
+
+// Colorize rows [y0, y1) of the region
+static void colorize_rows(const Frame* f, uint8_t* rgba, size_t rgba_stride, int y0, int y1) {
+    if (f->escape) {
+        colorize_smooth_rows(f, rgba, rgba_stride, y0, y1);
+        return;
+    }
+    mandel_colorize(frame_row(f, y0), f->stride, f->rect.x1 - f->rect.x0, y1 - y0,
+                    rgba + (size_t)(y0 - f->rect.y0) * rgba_stride, rgba_stride);
+}
+
+void mandel_default_options(MandelOptions* options) {
+    memset(options, 0, sizeof(*options));
+    options->kernel = mandel_avx2_ops.supported() ? MANDEL_KERNEL_AVX2 : MANDEL_KERNEL_SSE2;
+    options->run_count = 1;
+    options->symmetry = 1;
+    options->interleave = 1;
+    options->aa_threshold = MANDEL_AA_THRESHOLD;
+    options->de_mode = MANDEL_DE_OFF;
+    options->band_rows = MANDEL_BAND_ROWS;
+    options->fractal = MANDEL_FRACTAL_MANDELBROT;
+    options->power = 2;
+}
+
+MandelContext* mandel_create(const MandelOptions* options) {
+    MandelOptions defaults;
+    if (!options) {
+        mandel_default_options(&defaults);
+        options = &defaults;
+    }
+
+    MandelContext* ctx = (MandelContext*) calloc(1, sizeof(MandelContext));
+    if (!ctx) return NULL;
+    build_palette(ctx->palette);
+    if (mandel_set_options(ctx, options) != MANDEL_OK) {
+        free(ctx);
+        return NULL;
+    }
+    return ctx;
+}
+
+void mandel_destroy(MandelContext* ctx) {
+    if (!ctx) return;
+    for (int i = 0; i < SCRATCH_COUNT; i++) {
+        free(ctx->scratch[i].data);
+    }
+    free(ctx);
+}
+
+int mandel_set_options(MandelContext* ctx, const MandelOptions* options) {
+    if (!ctx || !options ||
+        options->kernel < MANDEL_KERNEL_SCALAR || options->kernel > MANDEL_KERNEL_AVX2 ||
+        options->run_count < 1 ||
+        options->interleave < 1 || options->interleave > MANDEL_MAX_INTERLEAVE ||
+        options->aa_threshold < 0 || options->band_rows < 0 ||
+        options->de_mode < MANDEL_DE_OFF || options->de_mode > MANDEL_DE_EXACT ||
+        options->fractal < MANDEL_FRACTAL_MANDELBROT || options->fractal > MANDEL_FRACTAL_JULIA ||
+        options->power < 2 || options->power > MANDEL_MAX_POWER) {
+        return MANDEL_ERR_ARGS;
+    }
+
+    const MandelKernelOps* ops = kernel_ops[options->kernel];
+    if ((ops->supported && !ops->supported()) ||
+        !ops->row[options->interleave - 1] ||
+        (options->de_mode != MANDEL_DE_OFF && (!ops->de_group || options->interleave > 1)) ||
+        (options->smooth && (!ops->smooth || options->de_mode == MANDEL_DE_INTERPOLATE))) {
+        return MANDEL_ERR_UNSUPPORTED;
+    }
+
+    // The distance-estimator kernels only iterate z^2 + c over the pixels
+    mandel_row_fn row = ops->row[options->interleave - 1];
+    mandel_points_fn points = ops->points;
+    if (options->fractal != MANDEL_FRACTAL_MANDELBROT || options->power != 2) {
+        if (!ops->formulas || options->de_mode != MANDEL_DE_OFF) return MANDEL_ERR_UNSUPPORTED;
+        row = ops->formulas[options->fractal][options->power - 2].row[options->interleave - 1];
+        points = ops->formulas[options->fractal][options->power - 2].points;
+        if (!row) return MANDEL_ERR_UNSUPPORTED;
+    }
+
+    ctx->options = *options;
+    ctx->ops = ops;
+    ctx->row = row;
+    ctx->points = points;
+    return MANDEL_OK;
+}
+
+const MandelOptions* mandel_get_options(const MandelContext* ctx) {
+    return &ctx->options;
+}
+
+// Interpolate the runs of skipped pixels of one row or column linearly between the
+// computed pixels bounding them (weight 2), or copy the one usable neighbor (weight 1).
+// Counts advance by iter_step along the line, fill/sum/weight by step.
+static void interpolate_line(const int* iterations, size_t iter_step, const unsigned char* fill,
+                             float* sum, unsigned char* weight, size_t step, int length) {
+    int before = -1;
+    for (int j = 0; j < length; j++) {
+        if (fill[j * step] == PIXEL_COMPUTED) {
+            before = j;
+            continue;
+        }
+        int after = j;
+        while (after < length && fill[after * step] != PIXEL_COMPUTED) after++;
+
+        // Boundary pixels drawn as part of the set are not valid endpoints
+        int a = before >= 0 ? iterations[before * iter_step] : MAX_ITER;
+        int b = after < length ? iterations[after * iter_step] : MAX_ITER;
+        for (int k = j; k < after; k++) {
+            if (a < MAX_ITER && b < MAX_ITER) {
+                float t = (float)(k - before) / (after - before);
+                sum[k * step] += 2 * (a + t * (b - a));
+                weight[k * step] += 2;
+            } else if (a < MAX_ITER || b < MAX_ITER) {
+                sum[k * step] += a < MAX_ITER ? a : b;
+                weight[k * step] += 1;
+            }
+        }
+        j = after - 1;
+    }
+}
+
+// Distance-estimator frame. An escaping sample with estimate D lies at least D/4 from
+// the set (Koebe 1/4 theorem), so pending pixels inside that disk are known exterior
+// and are filled without iterating: MANDEL_DE_INTERPOLATE blends counts from the
+// computed pixels around them, MANDEL_DE_EXACT recomputes them with the cheaper plain
+// kernel. Groups whose 4 pixels are all filled are skipped.
+static int de_begin(MandelContext* ctx, const Frame* f, DeState* de) {
+    size_t n = (size_t)(f->rect.x1 - f->rect.x0) * (f->rect.y1 - f->rect.y0);
+    de->interpolate = ctx->options.de_mode == MANDEL_DE_INTERPOLATE;
+    de->fill = (unsigned char*) scratch(ctx, SCRATCH_FILL, n);
+    de->exact = (int*) scratch(ctx, SCRATCH_EXACT, n * sizeof(int));
+    de->sum = de->interpolate ? (float*) scratch(ctx, SCRATCH_SUM, n * sizeof(float)) : NULL;
+    de->weight = de->interpolate ? (unsigned char*) scratch(ctx, SCRATCH_WEIGHT, n) : NULL;
+    de->finished = f->rect.y0;
+    de->skipped = 0;
+    if (!de->fill || !de->exact || (de->interpolate && (!de->sum || !de->weight))) {
+        return MANDEL_ERR_NOMEM;
+    }
+    memset(de->fill, PIXEL_PENDING, n);
+    return MANDEL_OK;
+}
+
+// Compute the pending groups of row y and mark the known-exterior disks of its pixels
+// in the rows below, which are still pending
+static void de_row(const MandelContext* ctx, Frame* f, DeState* de, int y) {
+    int w = f->rect.x1 - f->rect.x0;
+    int h = f->rect.y1 - f->rect.y0;
+    int ry = y - f->rect.y0;
+    int* row = frame_row(f, y);
+    float* escape_row = frame_escape(f, y);
+    unsigned char* row_fill = de->fill + (size_t)ry * w;
+
+    for (int x = 0; x < w; x += 4) {
+        int pending = 0;
+        for (int k = 0; k < 4 && x + k < w; k++) pending |= !row_fill[x + k];
+        if (!pending) continue;
+
+        int iter_result[4];
+        double distance[4];
+        float norm_result[4];
+        ctx->ops->de_group(f->rect.x0 + x, y, iter_result, distance,
+                           escape_row ? norm_result : NULL, &f->view);
+
+        for (int k = 0; k < 4 && x + k < w; k++) {
+            int px = x + k;
+            row[px] = iter_result[k];
+            if (escape_row) escape_row[px] = norm_result[k];
+            row_fill[px] = PIXEL_COMPUTED;
+
+            double radius = distance[k] / f->state->scale;   // In pixels
+            if (ctx->options.de_boundary && distance[k] > 0 && radius < 0.5) row[px] = MAX_ITER;
+
+            int r = (int)(0.25 * radius);
+            if (r > DE_MAX_RADIUS) r = DE_MAX_RADIUS;
+            for (int dy = 0; dy <= r && ry + dy < h; dy++) {
+                int dx = (int)sqrt((double)(r*r - dy*dy));
+                int x0 = dy == 0 ? px + 1 : (px - dx > 0 ? px - dx : 0);
+                int x1 = px + dx < w - 1 ? px + dx : w - 1;
+                unsigned char* span = de->fill + (size_t)(ry + dy) * w;
+                for (int fx = x0; fx <= x1; fx++) {
+                    span[fx] = span[fx] ? span[fx] : PIXEL_SKIPPED;
+                }
+            }
+        }
+    }
+}
+
+// Fill the skipped pixels of rows [de->finished, y_end), using the computed pixels of
+// the rows up to y_computed. They get the weighted mean of their row and column
+// interpolations; MANDEL_DE_EXACT, and pixels with no usable neighbor, go to the plain
+// kernel instead.
+static void de_finish_rows(const MandelContext* ctx, Frame* f, DeState* de, int y_end, int y_computed) {
+    int w = f->rect.x1 - f->rect.x0;
+    int y_begin = de->finished;
+    size_t first = (size_t)(y_begin - f->rect.y0) * w;
+    size_t n = (size_t)(y_end - y_begin) * w;
+    unsigned char* fill = de->fill + first;
+    de->finished = y_end;
+
+    if (de->interpolate) {
+        float* sum = de->sum + first;
+        unsigned char* weight = de->weight + first;
+        size_t span = (size_t)(y_computed - y_begin) * w;
+        memset(sum, 0, span * sizeof(float));
+        memset(weight, 0, span);
+        for (int y = y_begin; y < y_end; y++) {
+            size_t i = (size_t)(y - y_begin) * w;
+            interpolate_line(frame_row(f, y), 1, fill + i, sum + i, weight + i, 1, w);
+        }
+        // Columns run from the last final row to the last computed one, so runs
+        // crossing the band edges keep their endpoints
+        int above = y_begin > f->rect.y0 ? 1 : 0;
+        for (int x = 0; x < w; x++) {
+            interpolate_line(frame_row(f, y_begin - above) + x, f->stride, fill - above*w + x,
+                             sum - above*w + x, weight - above*w + x, w, y_computed - y_begin + above);
+        }
+    }
+
+    int exact_count = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (fill[i] != PIXEL_SKIPPED) continue;
+        de->skipped++;
+        if (de->interpolate && de->weight[first + i]) {
+            frame_row(f, y_begin + (int)(i / w))[i % w] =
+                (int)(de->sum[first + i] / de->weight[first + i] + 0.5f);
+            fill[i] = PIXEL_FILLED;
+        } else {
+            de->exact[exact_count++] = (int)i;
+            fill[i] = PIXEL_COMPUTED;
+        }
+    }
+
+    for (int j = 0; j < exact_count; j += DE_EXACT_CHUNK) {
+        int count = exact_count - j < DE_EXACT_CHUNK ? exact_count - j : DE_EXACT_CHUNK;
+        double px[DE_EXACT_CHUNK], py[DE_EXACT_CHUNK];
+        int iter_result[DE_EXACT_CHUNK];
+        float norm_result[DE_EXACT_CHUNK];
+        for (int k = 0; k < count; k++) {
+            px[k] = f->rect.x0 + de->exact[j + k] % w;
+            py[k] = y_begin + de->exact[j + k] / w;
+        }
+
+        ctx->points(px, py, count, iter_result, f->escape ? norm_result : NULL, &f->view);
+        for (int k = 0; k < count; k++) {
+            int y = y_begin + de->exact[j + k] / w;
+            int x = de->exact[j + k] % w;
+            frame_row(f, y)[x] = iter_result[k];
+            if (f->escape) frame_escape(f, y)[x] = norm_result[k];
+        }
+    }
+}
+
+// Compute rows [y_begin, y_end) of the region, copying rows whose mirror image about
+// the real axis was already computed (the set is symmetric under conjugation).
+// Row y samples cy = center_y + (y - height/2) * scale, so row height - y - k samples
+// exactly -cy when k = 2 * center_y / scale is an integer; odd k puts the axis between
+// two pixel rows. Views where k is off by more than SYMMETRY_EPS are computed in full.
+// Rows are produced in ascending order, so a band only needs the rows above it.
+// Julia sets are only symmetric about the real axis when c is real.
+// With de set, rows go through de_row and copies take over the fill state of their
+// source, so they are finished like it.
+static void compute_rows(const MandelContext* ctx, Frame* f, mandel_row_fn kernel, DeState* de,
+                         int y_begin, int y_end) {
+    const MandelOptions* opt = &ctx->options;
+    double k = 2.0 * f->state->center_y / f->state->scale;
+    int mirror = opt->symmetry && (opt->fractal == MANDEL_FRACTAL_MANDELBROT || opt->julia_y == 0) &&
+                 k > -f->height && k < f->height;
+    long shift = 0;
+
+    if (mirror) {
+        shift = (long)(k < 0 ? k - 0.5 : k + 0.5);
+        double misalign = k - shift;
+        mirror = misalign > -SYMMETRY_EPS && misalign < SYMMETRY_EPS;
+    }
+
+    size_t row_width = (size_t)(f->rect.x1 - f->rect.x0);
+    for (int y = y_begin; y < y_end; y++) {
+        long m = f->height - y - shift;
+        if (mirror && m >= f->rect.y0 && m < y) {
+            memcpy(frame_row(f, y), frame_row(f, (int)m), row_width * sizeof(int));
+            if (f->escape) memcpy(frame_escape(f, y), frame_escape(f, (int)m), row_width * sizeof(float));
+            if (de) {
+                memcpy(de->fill + (y - f->rect.y0) * row_width,
+                       de->fill + (m - f->rect.y0) * row_width, row_width);
+            }
+        } else if (de) {
+            de_row(ctx, f, de, y);
+        } else {
+            kernel(frame_row(f, y), frame_escape(f, y), y, &f->view);
+        }
+    }
+}
+
+// Deterministic per-sample jitter in [-0.5, 0.5), stable between frames
+static inline double aa_jitter(unsigned int seed) {
+    seed ^= seed >> 16;
+    seed *= 0x7feb352dU;
+    seed ^= seed >> 15;
+    seed *= 0x846ca68bU;
+    seed ^= seed >> 16;
+    return (seed & 0xFFFF) / 65536.0 - 0.5;
+}
+
+// Counts of the one-pixel ring around the region that lies inside the image: the rows
+// above and below at halo and halo + w, the columns left and right at halo + 2w and
+// halo + 2w + h. Edge detection sees the same neighbors as in a whole-image render.
+static void compute_halo(Frame* f, mandel_row_fn kernel, int* halo) {
+    int w = f->rect.x1 - f->rect.x0;
+    int h = f->rect.y1 - f->rect.y0;
+    if (f->rect.y0 > 0) kernel(halo, NULL, f->rect.y0 - 1, &f->view);
+    if (f->rect.y1 < f->height) kernel(halo + w, NULL, f->rect.y1, &f->view);
+
+    // One-pixel rows for the columns
+    int x0 = f->view.x0, x1 = f->view.x1;
+    for (int side = 0; side < 2; side++) {
+        int x = side ? x1 : x0 - 1;
+        if (x < 0 || x >= f->width) continue;
+        f->view.x0 = x;
+        f->view.x1 = x + 1;
+        int* column = halo + 2*w + side*h;
+        for (int y = 0; y < h; y++) kernel(column + y, NULL, f->rect.y0 + y, &f->view);
+    }
+    f->view.x0 = x0;
+    f->view.x1 = x1;
+}
+
+// Collect region pixels whose iteration count differs from a 4-neighbor by more than
+// threshold, as offsets y * region_width + x. Neighbors outside the region come from
+// the halo of compute_halo.
+static int find_edge_pixels(const Frame* f, int threshold, const int* halo, int* edges) {
+    int w = f->rect.x1 - f->rect.x0;
+    int h = f->rect.y1 - f->rect.y0;
+    int has_left = f->rect.x0 > 0;
+    int has_right = f->rect.x1 < f->width;
+    const int* left = halo + 2*w;
+    const int* right = left + h;
+    int count = 0;
+
+    for (int y = 0; y < h; y++) {
+        const int* row = f->iterations + y * f->stride;
+        const int* above = y > 0 ? row - f->stride : f->rect.y0 > 0 ? halo : NULL;
+        const int* below = y < h - 1 ? row + f->stride : f->rect.y1 < f->height ? halo + w : NULL;
+        for (int x = 0; x < w; x++) {
+            int it = row[x];
+
+            if ((x > 0 ? abs(it - row[x - 1]) > threshold : has_left && abs(it - left[y]) > threshold) ||
+                (x < w - 1 ? abs(it - row[x + 1]) > threshold : has_right && abs(it - right[y]) > threshold) ||
+                (above && abs(it - above[x]) > threshold) ||
+                (below && abs(it - below[x]) > threshold)) {
+                edges[count++] = y * w + x;
+            }
+        }
+    }
+    return count;
+}
+
+// Resample edge pixels on a jittered 2x2 grid. The jitter is seeded by the image
+// pixel index, so a pixel gets the same samples whichever region it is rendered in.
+static void supersample_edges(Frame* f, mandel_points_fn points, const int* edges,
+                              int edge_count, int* samples, float* sample_norm, double* coords) {
+    static const double grid[AA_SAMPLES][2] = {
+        {-0.25, -0.25}, {0.25, -0.25}, {-0.25, 0.25}, {0.25, 0.25}
+    };
+    int w = f->rect.x1 - f->rect.x0;
+    int count = edge_count * AA_SAMPLES;
+    double* px = coords;
+    double* py = coords + count;
+
+    for (int e = 0; e < edge_count; e++) {
+        int x = f->rect.x0 + edges[e] % w;
+        int y = f->rect.y0 + edges[e] / w;
+
+        for (int k = 0; k < AA_SAMPLES; k++) {
+            unsigned int seed = (unsigned int)((y * f->width + x) * AA_SAMPLES + k);
+            px[e*AA_SAMPLES + k] = x + grid[k][0] + 0.5 * aa_jitter(2*seed);
+            py[e*AA_SAMPLES + k] = y + grid[k][1] + 0.5 * aa_jitter(2*seed + 1);
+        }
+    }
+
+    points(px, py, count, samples, sample_norm, &f->view);
+}
+
+// Edge pixels get the average color of their subsamples; returns their bounding box.
+// With smooth coloring sample_norm holds the escape |z|^2 of the samples, and the
+// AA_SAMPLES (4) samples of a pixel are indexed as one vector.
+static MandelRect blend_edges(const Frame* f, const int* edges, int edge_count, const int* samples,
+                              const float* sample_norm, uint8_t* rgba, size_t rgba_stride) {
+    int w = f->rect.x1 - f->rect.x0;
+    MandelRect box = {w, f->rect.y1 - f->rect.y0, 0, 0};
+
+    for (int e = 0; e < edge_count; e++) {
+        int r = 0, g = 0, b = 0;
+        int index[AA_SAMPLES];
+        if (sample_norm) {
+            _mm_storeu_si128((__m128i*)index,
+                             smooth_index(_mm_loadu_si128((const __m128i*)(samples + e*AA_SAMPLES)),
+                                          _mm_loadu_ps(sample_norm + e*AA_SAMPLES), f->inv_log2_power));
+        }
+        for (int k = 0; k < AA_SAMPLES; k++) {
+            uint8_t color[4];
+            if (sample_norm) {
+                memcpy(color, &f->palette[index[k]], 4);
+            } else {
+                get_color(samples[e*AA_SAMPLES + k], color);
+            }
+            r += color[0];
+            g += color[1];
+            b += color[2];
+        }
+
+        int x = edges[e] % w;
+        int y = edges[e] / w;
+        uint8_t* pixel = rgba + y * rgba_stride + 4*x;
+        pixel[0] = (uint8_t)(r / AA_SAMPLES);
+        pixel[1] = (uint8_t)(g / AA_SAMPLES);
+        pixel[2] = (uint8_t)(b / AA_SAMPLES);
+
+        if (x < box.x0) box.x0 = x;
+        if (y < box.y0) box.y0 = y;
+        if (x + 1 > box.x1) box.x1 = x + 1;
+        if (y + 1 > box.y1) box.y1 = y + 1;
+    }
+
+    return (MandelRect){f->rect.x0 + box.x0, f->rect.y0 + box.y0,
+                        f->rect.x0 + box.x1, f->rect.y0 + box.y1};
+}
+
+// Double ops per lane per iteration of z^power + c, counted like MANDEL_FLOPS_PER_STEP:
+// 5 per squaring and 6 per multiplication by z along the bits of power, add c, norm
+static int flops_per_step(int power) {
+    int flops = 2 + 3;
+    for (int bit = 30 - __builtin_clz(power); bit >= 0; bit--) {
+        flops += 5 + (power & (1 << bit) ? 6 : 0);
+    }
+    return flops;
+}
+
+static int report(const MandelOptions* opt, MandelRect rect) {
+    return opt->on_progress && opt->on_progress(&rect, opt->user) ? MANDEL_CANCELLED : MANDEL_OK;
+}
+
+int mandel_render(MandelContext* ctx, const MandelbrotState* state, const MandelImage* image,
+                  MandelStats* stats) {
+    if (!ctx || !state || !image || (!image->iterations && !image->rgba) ||
+        image->width <= 0 || image->height <= 0 || !(state->scale > 0)) {
+        return MANDEL_ERR_ARGS;
+    }
+
+    MandelRect rect = image->region;
+    if (rect.x0 >= rect.x1 || rect.y0 >= rect.y1) {
+        rect = (MandelRect){0, 0, image->width, image->height};
+    }
+    if (rect.x0 < 0 || rect.y0 < 0 || rect.x1 > image->width || rect.y1 > image->height) {
+        return MANDEL_ERR_ARGS;
+    }
+
+    int w = rect.x1 - rect.x0;
+    int h = rect.y1 - rect.y0;
+    uint8_t* rgba = image->rgba;
+    size_t rgba_stride = image->rgba_stride;
+    if (rgba && rgba_stride < (size_t)w * 4) return MANDEL_ERR_ARGS;
+
+    Frame f = {.state = state, .width = image->width, .height = image->height, .rect = rect,
+               .iterations = image->iterations, .stride = image->iter_stride};
+    if (f.iterations) {
+        if (f.stride < (size_t)w) return MANDEL_ERR_ARGS;
+    } else {
+        f.iterations = (int*) scratch(ctx, SCRATCH_ITERATIONS, (size_t)w * h * sizeof(int));
+        f.stride = w;
+        if (!f.iterations) return MANDEL_ERR_NOMEM;
+    }
+    // Escape norms are only worth capturing when there are pixels to color
+    if (ctx->options.smooth && rgba) {
+        f.escape = (float*) scratch(ctx, SCRATCH_ESCAPE, (size_t)w * h * sizeof(float));
+        f.palette = ctx->palette;
+        f.inv_log2_power = (float)(1.0 / log2(ctx->options.power));
+        if (!f.escape) return MANDEL_ERR_NOMEM;
+    }
+    f.view = (MandelKernelView){
+        state->center_x, state->center_y, state->scale,
+        image->width / 2.0, image->height / 2.0,
+        ctx->options.julia_x, ctx->options.julia_y,
+        rect.x0, rect.x1, 0, 0
+    };
+
+    const MandelOptions* opt = &ctx->options;
+    mandel_row_fn kernel = ctx->row;
+    int band_rows = opt->band_rows > 0 ? opt->band_rows : MANDEL_BAND_ROWS;
+    DeState de_state;
+    DeState* de = opt->de_mode != MANDEL_DE_OFF ? &de_state : NULL;
+    int aa = opt->aa;
+    int* edges = NULL;
+    int* halo = NULL;
+    int* samples = NULL;
+    float* sample_norm = NULL;
+    int edge_count = 0;
+    MandelStats st = {0};
+    int status = MANDEL_OK;
+
+    if (aa) {
+        edges = (int*) scratch(ctx, SCRATCH_EDGES, (size_t)w * h * sizeof(int));
+        halo = (int*) scratch(ctx, SCRATCH_HALO, 2 * ((size_t)w + h) * sizeof(int));
+        if (!edges || !halo) return MANDEL_ERR_NOMEM;
+    }
+
+    for (int r = 0; status == MANDEL_OK && r < opt->run_count; r++) {
+        int last = r == opt->run_count - 1;
+
+        if (de) status = de_begin(ctx, &f, de);
+
+        for (int y0 = rect.y0; status == MANDEL_OK && y0 < rect.y1; y0 += band_rows) {
+            int y1 = y0 + band_rows < rect.y1 ? y0 + band_rows : rect.y1;
+            int done = de ? de->finished : y0;
+
+            double start = thread_seconds();
+            uint64_t start_cycles = __rdtsc();
+            compute_rows(ctx, &f, kernel, de, y0, y1);
+            // DE bands are finished one band late, when the pixels below them are known
+            if (de) de_finish_rows(ctx, &f, de, y1 < rect.y1 ? y0 : y1, y1);
+            st.cycles += __rdtsc() - start_cycles;
+            st.compute_time += thread_seconds() - start;
+
+            // Hand out finished bands while the rest of the region is still computing
+            int done_end = de ? de->finished : y1;
+            if (last && done_end > done) {
+                if (rgba) colorize_rows(&f, rgba, rgba_stride, done, done_end);
+                status = report(opt, (MandelRect){rect.x0, done, rect.x1, done_end});
+            }
+        }
+        if (de) st.de_skipped = de->skipped;
+
+        // Adaptive AA: only pixels on iteration-count edges get subsamples. They only
+        // feed the RGBA blend, so without RGBA output the edges are just counted.
+        if (aa && status == MANDEL_OK) {
+            double start = thread_seconds();
+            compute_halo(&f, kernel, halo);
+            edge_count = find_edge_pixels(&f, opt->aa_threshold, halo, edges);
+            if (!rgba) {
+                st.compute_time += thread_seconds() - start;
+                continue;
+            }
+            size_t count = (size_t)edge_count * AA_SAMPLES;
+            samples = (int*) scratch(ctx, SCRATCH_SAMPLES, count * sizeof(int));
+            double* coords = (double*) scratch(ctx, SCRATCH_COORDS, 2 * count * sizeof(double));
+            if (f.escape) sample_norm = (float*) scratch(ctx, SCRATCH_SAMPLE_ESCAPE, count * sizeof(float));
+            if (!samples || !coords || (f.escape && !sample_norm)) {
+                status = MANDEL_ERR_NOMEM;
+                break;
+            }
+            supersample_edges(&f, ctx->points, edges, edge_count, samples, sample_norm, coords);
+            st.compute_time += thread_seconds() - start;
+        }
+    }
+
+    if (aa && rgba && edge_count && status == MANDEL_OK) {
+        status = report(opt, blend_edges(&f, edges, edge_count, samples, sample_norm, rgba, rgba_stride));
+    }
+
+    st.flops = (double)f.view.lane_steps * flops_per_step(opt->power) +
+               (double)f.view.de_lane_steps * MANDEL_DE_FLOPS_PER_STEP;
+    st.aa_edge_count = edge_count;
+    if (stats) *stats = st;
+    return status;
+}
+
+int mandel_render_iterations(MandelContext* ctx, const MandelbrotState* state, int width, int height,
+                             int* iterations, size_t stride, MandelStats* stats) {
+    MandelImage image = {width, height, {0, 0, 0, 0}, iterations, stride, NULL, 0};
+    return mandel_render(ctx, state, &image, stats);
+}
+
+int mandel_render_rgba(MandelContext* ctx, const MandelbrotState* state, int width, int height,
+                       uint8_t* rgba, size_t stride, MandelStats* stats) {
+    MandelImage image = {width, height, {0, 0, 0, 0}, NULL, 0, rgba, stride};
+    return mandel_render(ctx, state, &image, stats);
+}
@@ -0,0 +1,201 @@
+// libmandel: reentrant Mandelbrot renderer
+//
+// All state lives in a MandelContext. Contexts do not share anything, so one
+// context per thread can render concurrently; a single context must not be used
+// from two threads at once. The library never allocates the output buffers and
+// has no windowing dependency.
+#ifndef MANDEL_H
+#define MANDEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Public entry points; everything else in the library is hidden from libmandel.so
+#define MANDEL_API __attribute__((visibility("default")))
+
+#define MANDEL_MAX_ITER 256         // Maximum iterations per pixel
+#define MANDEL_ESCAPE_RADIUS 10.0   // Escape radius
+#define MANDEL_MAX_INTERLEAVE 4     // Pixel groups the interleaved AVX2 kernel keeps in flight
+#define MANDEL_AA_SAMPLES 4         // Jittered subsamples per edge pixel
+#define MANDEL_AA_THRESHOLD 4       // Default iteration difference that marks an edge pixel
+#define MANDEL_BAND_ROWS 32         // Default rows per progress callback
+#define MANDEL_MAX_POWER 8          // Highest exponent d of z^d + c
+
+// Return codes
+#define MANDEL_OK 0
+#define MANDEL_CANCELLED 1          // The progress callback asked to stop
+#define MANDEL_ERR_ARGS (-1)        // Invalid view, image or buffer
+#define MANDEL_ERR_NOMEM (-2)
+#define MANDEL_ERR_UNSUPPORTED (-3) // Kernel or option not available on this CPU/kernel
+
+typedef enum {
+    MANDEL_KERNEL_SCALAR,   // Level 1: one pixel at a time
+    MANDEL_KERNEL_UNROLL4,  // Level 2: 4 pixels per step with scalar ops
+    MANDEL_KERNEL_SSE2,     // Level 3: __m128d, 2 pixels per step
+    MANDEL_KERNEL_AVX2      // Level 4: __m256d + FMA, 4 pixels per step
+} MandelKernel;
+
+// Iterated formula z = z^power + c, with z starting at the pixel
+typedef enum {
+    MANDEL_FRACTAL_MANDELBROT,  // c is the pixel (Multibrot for power > 2)
+    MANDEL_FRACTAL_JULIA        // c is fixed by the options
+} MandelFractal;
+
+// Distance-estimator exterior skipping. Its kernel iterates one pixel group at a time,
+// so it only beats the plain kernel in sparse filament views where most pixels are
+// skipped, and never beats interleave > 1, which it cannot be combined with.
+typedef enum {
+    MANDEL_DE_OFF,
+    MANDEL_DE_INTERPOLATE,  // Fill known-exterior pixels from their computed neighbors
+    MANDEL_DE_EXACT         // Recompute known-exterior pixels with the plain kernel
+} MandelDeMode;
+
+// View of the complex plane: pixel (x, y) of a width x height image samples
+// c = center + ((x - width/2) + i (y - height/2)) * scale
+typedef struct {
+    double center_x;     // X center coordinate
+    double center_y;     // Y center coordinate
+    double scale;        // Zoom scale factor (complex units per pixel)
+    int color_formula;   // Color formula selector
+} MandelbrotState;
+
+// Pixel rectangle [x0, x1) x [y0, y1)
+typedef struct {
+    int x0, y0;
+    int x1, y1;
+} MandelRect;
+
+// Called on the rendering thread with a rectangle (in image coordinates) whose
+// iterations, and RGBA pixels when requested, are final. Returning nonzero cancels
+// the render, which then returns MANDEL_CANCELLED.
+typedef int (*MandelProgressCallback)(const MandelRect* rect, void* user);
+
+typedef struct {
+    MandelKernel kernel;
+    int run_count;          // Repeat the computation for benchmarking (>= 1)
+    int symmetry;           // Mirror rows about the real axis when the view allows it
+    int interleave;         // AVX2 only: pixel groups advanced per step, 1..MANDEL_MAX_INTERLEAVE
+    int aa;                 // Supersample edge pixels; the samples are blended into RGBA output,
+                            // so without RGBA output the edges are only counted.
+                            // Edges are found against the pixels around the region too, so
+                            // regions of an image match the whole-image render
+    int aa_threshold;
+    int smooth;             // SSE2/AVX2 only: continuous coloring from the escape |z|^2, RGBA output only;
+                            // not with MANDEL_DE_INTERPOLATE, whose filled pixels have no |z|
+    MandelDeMode de_mode;   // AVX2 with interleave 1 only: distance-estimator exterior skipping
+    int de_boundary;        // With de_mode, draw points within half a pixel of the set as the set
+    int band_rows;          // Rows between progress callbacks
+    // Formula. Anything but the z^2 Mandelbrot set needs SSE2/AVX2 and no DE.
+    MandelFractal fractal;
+    int power;              // 2..MANDEL_MAX_POWER
+    double julia_x;         // c of MANDEL_FRACTAL_JULIA
+    double julia_y;
+    MandelProgressCallback on_progress;  // Optional
+    void* user;
+} MandelOptions;
+
+// Render target. The region may be any rectangle of the image; buffers hold the
+// region only, with row y of the region starting at y * stride.
+typedef struct {
+    int width, height;      // Full image size, the view center maps to (width/2, height/2)
+    MandelRect region;      // Region to render, an empty rect means the whole image
+    int* iterations;        // Optional iteration counts
+    size_t iter_stride;     // In elements
+    uint8_t* rgba;          // Optional RGBA8 pixels
+    size_t rgba_stride;     // In bytes
+} MandelImage;
+
+// Counters of the last render
+typedef struct {
+    double compute_time;    // Thread CPU seconds spent computing, without coloring or callbacks
+    double flops;           // Double-precision operations executed by the kernels
+    uint64_t cycles;        // TSC cycles spent in the kernels
+    int aa_edge_count;      // Edge pixels found (resampled with RGBA output)
+    int de_skipped;         // Pixels filled without iteration
+} MandelStats;
+
+typedef struct MandelContext MandelContext;
+
+MANDEL_API void mandel_default_options(MandelOptions* options);
+
+// Returns NULL when out of memory or when mandel_set_options rejects the options
+MANDEL_API MandelContext* mandel_create(const MandelOptions* options);
+MANDEL_API void mandel_destroy(MandelContext* ctx);
+
+// Returns MANDEL_ERR_UNSUPPORTED if the kernel or an option cannot run here
+MANDEL_API int mandel_set_options(MandelContext* ctx, const MandelOptions* options);
+MANDEL_API const MandelOptions* mandel_get_options(const MandelContext* ctx);
+
+// Render state into image. stats may be NULL.
+MANDEL_API int mandel_render(MandelContext* ctx, const MandelbrotState* state, const MandelImage* image,
+                             MandelStats* stats);
+
+// Whole-image shortcuts
+MANDEL_API int mandel_render_iterations(MandelContext* ctx, const MandelbrotState* state,
+                                        int width, int height, int* iterations, size_t stride,
+                                        MandelStats* stats);
+MANDEL_API int mandel_render_rgba(MandelContext* ctx, const MandelbrotState* state,
+                                  int width, int height, uint8_t* rgba, size_t stride,
+                                  MandelStats* stats);
+
+// Map width x height iteration counts to RGBA8 pixels
+MANDEL_API void mandel_colorize(const int* iterations, size_t iter_stride, int width, int height,
+                                uint8_t* rgba, size_t rgba_stride);
+
+// Iteration cache files: a header and width*height uint16 counts with a checksum.
+// Both return 1 on success; reading fails if the file is missing, corrupt, or was
+// rendered for a different view or size.
+MANDEL_API int mandel_cache_write(const char* path, const MandelbrotState* state, int width, int height,
+                                  const int* iterations);
+MANDEL_API int mandel_cache_read(const char* path, const MandelbrotState* state, int width, int height,
+                                 int* iterations);
+
+// Speculative background rendering. Worker threads run at idle priority, each with
+// its own context, and render requested views into a bounded store of finished
+// frames that is evicted least recently used first.
+#define MANDEL_PREFETCH_QUEUE 16    // Views waiting for a worker
+
+typedef struct MandelPrefetch MandelPrefetch;
+
+typedef struct {
+    uint64_t requested;     // Views queued
+    uint64_t rendered;      // Views finished and stored
+    uint64_t cancelled;     // Renders stopped because the view was no longer wanted
+    uint64_t hits;          // Lookups served from the store
+    uint64_t misses;
+} MandelPrefetchStats;
+
+// Render width x height frames with options (run_count and the progress callback are
+// replaced) on threads workers, keeping up to capacity frames. With keep_rgba the
+// store also keeps colored pixels. Returns NULL on failure.
+MANDEL_API MandelPrefetch* mandel_prefetch_create(const MandelOptions* options, int width, int height,
+                                                  int threads, int capacity, int keep_rgba);
+MANDEL_API void mandel_prefetch_destroy(MandelPrefetch* prefetch);
+
+// Replace the queued work with views, most wanted first. Running renders of views
+// not in the list are cancelled; stored views are not rendered again.
+MANDEL_API void mandel_prefetch_request(MandelPrefetch* prefetch, const MandelbrotState* views,
+                                        int count);
+
+// Copy the stored frame for state into iterations (stride width) and, when rgba is
+// not NULL, its pixels (stride width * 4). Waits for a worker already rendering it
+// while that render makes progress, and cancels it if it stalls.
+// Returns 0 on a miss; the view is then dropped from the queue for the caller to render.
+MANDEL_API int mandel_prefetch_lookup(MandelPrefetch* prefetch, const MandelbrotState* state,
+                                      int* iterations, uint8_t* rgba);
+
+// Add a frame the caller rendered itself, so returning to it is a hit
+MANDEL_API void mandel_prefetch_put(MandelPrefetch* prefetch, const MandelbrotState* state,
+                                    const int* iterations, const uint8_t* rgba);
+
+MANDEL_API void mandel_prefetch_stats(MandelPrefetch* prefetch, MandelPrefetchStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,64 @@
+// Interface between the render driver (mandel.c) and the kernel translation units.
+// Kernels map pixel coordinates to the plane themselves, so each level keeps the
+// exact arithmetic (and FP contraction) of the flags its TU is built with.
+#ifndef MANDEL_INTERNAL_H
+#define MANDEL_INTERNAL_H
+
+#include "mandel.h"
+
+#define MANDEL_FLOPS_PER_STEP 10     // Double ops per lane per iteration (3 mul, sub, add, FMA = 2, norm = 3)
+#define MANDEL_DE_FLOPS_PER_STEP 18  // MANDEL_FLOPS_PER_STEP plus the dz = 2*z*dz + 1 update
+#define MANDEL_FRACTAL_COUNT 2
+#define MANDEL_POWER_COUNT (MANDEL_MAX_POWER - 1)   // Exponents 2..MANDEL_MAX_POWER
+
+// Pixel-to-plane mapping of one render, plus counters the kernels accumulate
+typedef struct {
+    double center_x, center_y;
+    double scale;
+    double half_width;      // Pixel coordinates of the view center
+    double half_height;
+    double julia_x, julia_y;  // c of Julia sets
+    int x0, x1;             // Columns a row kernel computes, row[0] is column x0
+    uint64_t lane_steps;    // Lane iterations executed by row kernels
+    uint64_t de_lane_steps; // Lane iterations executed by the distance estimator
+} MandelKernelView;
+
+// The escape_norm arguments are NULL unless the render uses smooth coloring; kernels
+// with smooth set then store the |z|^2 each pixel escaped with (undefined for pixels
+// that reached MAX_ITER). Other kernels never receive one.
+
+// Compute columns [x0, x1) of pixel row y
+typedef void (*mandel_row_fn)(int* row, float* escape_norm, int y, MandelKernelView* view);
+
+// Iterate count points given in (fractional) pixel coordinates
+typedef void (*mandel_points_fn)(const double* px, const double* py, int count,
+                                 int* iterations, float* escape_norm, MandelKernelView* view);
+
+// Iterate the 4 pixels (x..x+3, y) tracking dz/dc. distance[k] receives the exterior
+// distance estimate 2|z|ln|z|/|dz| in plane units, 0 for pixels that reached MAX_ITER.
+typedef void (*mandel_de_fn)(int x, int y, int iterations[4], double distance[4],
+                             float escape_norm[4], MandelKernelView* view);
+
+// Row and point functions of one formula, specialized at compile time
+typedef struct {
+    mandel_row_fn row[MANDEL_MAX_INTERLEAVE];  // As MandelKernelOps.row
+    mandel_points_fn points;
+} MandelFormulaKernels;
+
+typedef struct {
+    const char* name;
+    mandel_row_fn row[MANDEL_MAX_INTERLEAVE];  // row[n-1] keeps n groups in flight, NULL if absent
+    mandel_points_fn points;
+    mandel_de_fn de_group;                     // NULL when the kernel has no distance estimator
+    int smooth;                                // Fills escape_norm for smooth coloring
+    const MandelFormulaKernels (*formulas)[MANDEL_POWER_COUNT];  // [fractal][power - 2], NULL if
+                                                                 // the kernel only has z^2 Mandelbrot
+    int (*supported)(void);                    // NULL when the kernel runs on any x86-64 CPU
+} MandelKernelOps;
+
+extern const MandelKernelOps mandel_scalar_ops;
+extern const MandelKernelOps mandel_unroll4_ops;
+extern const MandelKernelOps mandel_sse2_ops;
+extern const MandelKernelOps mandel_avx2_ops;
+
+#endif
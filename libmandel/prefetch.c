@@ -0,0 +1,335 @@
+// Speculative background rendering of views the caller expects to need next.
+// Workers run at idle priority with their own contexts; finished frames go into
+// a bounded LRU store.
+#define _GNU_SOURCE     // For SCHED_IDLE
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "mandel.h"
+
+// Longest a lookup waits for a worker rendering the view to finish another band. An
+// idle-priority worker may get no CPU at all while other threads are busy, so when it
+// stalls the caller renders the view itself.
+#define LOOKUP_STALL_NS 50000000L
+
+typedef struct {
+    MandelbrotState state;
+    uint16_t* counts;       // Counts never exceed MANDEL_MAX_ITER
+    uint8_t* rgba;          // NULL unless the store keeps pixels
+    int has_rgba;           // rgba holds the pixels of state
+    uint64_t last_used;     // 0 for an empty slot
+} Entry;
+
+typedef struct {
+    MandelPrefetch* prefetch;
+    pthread_t thread;
+    MandelbrotState state;  // View being rendered while busy
+    int busy;
+    atomic_int cancel;      // Set when state is no longer wanted
+    atomic_uint bands;      // Progress callbacks of the current render
+    int* iterations;
+    uint8_t* rgba;
+} Worker;
+
+struct MandelPrefetch {
+    MandelOptions options;
+    int width, height;
+    int keep_rgba;
+
+    pthread_mutex_t lock;
+    pthread_cond_t work;    // Queue filled or stopping
+    pthread_cond_t done;    // A worker finished a render
+    MandelbrotState queue[MANDEL_PREFETCH_QUEUE];
+    int queued;
+    int stopping;
+
+    Worker* workers;
+    int worker_count;
+    int thread_count;       // Workers whose thread is running
+    Entry* entries;
+    int capacity;
+    uint64_t clock;
+    MandelPrefetchStats stats;
+};
+
+static int same_view(const MandelbrotState* a, const MandelbrotState* b) {
+    return a->center_x == b->center_x && a->center_y == b->center_y &&
+           a->scale == b->scale && a->color_formula == b->color_formula;
+}
+
+static Entry* find_entry(MandelPrefetch* p, const MandelbrotState* state) {
+    for (int i = 0; i < p->capacity; i++) {
+        if (p->entries[i].last_used && same_view(&p->entries[i].state, state)) return &p->entries[i];
+    }
+    return NULL;
+}
+
+// Worker still rendering state; cancelled renders do not count
+static Worker* find_worker(MandelPrefetch* p, const MandelbrotState* state) {
+    for (int i = 0; i < p->thread_count; i++) {
+        Worker* w = &p->workers[i];
+        if (w->busy && !atomic_load(&w->cancel) && same_view(&w->state, state)) return w;
+    }
+    return NULL;
+}
+
+// Copy a frame into its entry, or over the least recently used one. Caller holds the lock.
+static void store(MandelPrefetch* p, const MandelbrotState* state, const int* iterations,
+                  const uint8_t* rgba) {
+    Entry* e = find_entry(p, state);
+    if (!e) {
+        e = &p->entries[0];
+        for (int i = 1; i < p->capacity; i++) {
+            if (p->entries[i].last_used < e->last_used) e = &p->entries[i];
+        }
+    }
+
+    size_t count = (size_t)p->width * p->height;
+    for (size_t i = 0; i < count; i++) {
+        e->counts[i] = (uint16_t) iterations[i];
+    }
+    e->has_rgba = e->rgba && rgba;
+    if (e->has_rgba) memcpy(e->rgba, rgba, count * 4);
+    e->state = *state;
+    e->last_used = ++p->clock;
+}
+
+static int check_cancel(const MandelRect* rect, void* user) {
+    (void) rect;
+    Worker* w = (Worker*) user;
+    atomic_fetch_add_explicit(&w->bands, 1, memory_order_relaxed);
+    return atomic_load_explicit(&w->cancel, memory_order_relaxed);
+}
+
+// Speculative frames must not slow down the interactive one
+static void lower_priority(void) {
+#ifdef SCHED_IDLE
+    struct sched_param param = {0};
+    pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#endif
+}
+
+// Someone is waiting for this render, so it is no longer speculative. Leaving
+// SCHED_IDLE needs CAP_SYS_NICE or a RLIMIT_NICE allowance, so this may fail; the
+// lookup wait is bounded either way. The worker lowers itself again per render.
+static void raise_priority(Worker* w) {
+    struct sched_param param = {0};
+    pthread_setschedparam(w->thread, SCHED_OTHER, &param);
+}
+
+static void* worker_main(void* arg) {
+    Worker* w = (Worker*) arg;
+    MandelPrefetch* p = w->prefetch;
+    lower_priority();
+
+    MandelOptions options = p->options;
+    options.run_count = 1;
+    options.on_progress = check_cancel;
+    options.user = w;
+    MandelContext* ctx = mandel_create(&options);
+
+    pthread_mutex_lock(&p->lock);
+    while (!p->stopping) {
+        if (!p->queued || !ctx) {
+            pthread_cond_wait(&p->work, &p->lock);
+            continue;
+        }
+
+        MandelbrotState state = p->queue[0];
+        memmove(p->queue, p->queue + 1, --p->queued * sizeof(MandelbrotState));
+        if (find_entry(p, &state) || find_worker(p, &state)) continue;
+
+        w->state = state;
+        w->busy = 1;
+        atomic_store(&w->cancel, 0);
+        atomic_store(&w->bands, 0);
+        pthread_mutex_unlock(&p->lock);
+        lower_priority();
+
+        MandelImage image = {p->width, p->height, {0, 0, 0, 0}, w->iterations, p->width,
+                             w->rgba, (size_t)p->width * 4};
+        int status = mandel_render(ctx, &state, &image, NULL);
+
+        pthread_mutex_lock(&p->lock);
+        w->busy = 0;
+        if (status == MANDEL_OK) {
+            store(p, &state, w->iterations, w->rgba);
+            p->stats.rendered++;
+        } else {
+            p->stats.cancelled++;
+        }
+        pthread_cond_broadcast(&p->done);
+    }
+    pthread_mutex_unlock(&p->lock);
+
+    mandel_destroy(ctx);
+    return NULL;
+}
+
+MandelPrefetch* mandel_prefetch_create(const MandelOptions* options, int width, int height,
+                                       int threads, int capacity, int keep_rgba) {
+    if (!options || width <= 0 || height <= 0 || threads < 1 || capacity < 1) return NULL;
+
+    MandelPrefetch* p = (MandelPrefetch*) calloc(1, sizeof(MandelPrefetch));
+    if (!p) return NULL;
+    p->options = *options;
+    p->width = width;
+    p->height = height;
+    p->keep_rgba = keep_rgba;
+    p->capacity = capacity;
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->work, NULL);
+    pthread_cond_init(&p->done, NULL);
+
+    size_t count = (size_t)width * height;
+    p->entries = (Entry*) calloc(capacity, sizeof(Entry));
+    p->workers = (Worker*) calloc(threads, sizeof(Worker));
+    p->worker_count = p->workers ? threads : 0;
+    int ok = p->entries && p->workers;
+    for (int i = 0; ok && i < capacity; i++) {
+        p->entries[i].counts = (uint16_t*) malloc(count * sizeof(uint16_t));
+        p->entries[i].rgba = keep_rgba ? (uint8_t*) malloc(count * 4) : NULL;
+        ok = p->entries[i].counts && (!keep_rgba || p->entries[i].rgba);
+    }
+    for (int i = 0; ok && i < threads; i++) {
+        Worker* w = &p->workers[i];
+        w->prefetch = p;
+        w->iterations = (int*) malloc(count * sizeof(int));
+        w->rgba = keep_rgba ? (uint8_t*) malloc(count * 4) : NULL;
+        ok = w->iterations && (!keep_rgba || w->rgba) &&
+             pthread_create(&w->thread, NULL, worker_main, w) == 0;
+        if (ok) p->thread_count++;
+    }
+
+    if (!ok) {
+        mandel_prefetch_destroy(p);
+        return NULL;
+    }
+    return p;
+}
+
+void mandel_prefetch_destroy(MandelPrefetch* p) {
+    if (!p) return;
+
+    pthread_mutex_lock(&p->lock);
+    p->stopping = 1;
+    for (int i = 0; i < p->thread_count; i++) {
+        atomic_store(&p->workers[i].cancel, 1);
+    }
+    pthread_cond_broadcast(&p->work);
+    pthread_mutex_unlock(&p->lock);
+
+    for (int i = 0; i < p->thread_count; i++) {
+        pthread_join(p->workers[i].thread, NULL);
+    }
+    for (int i = 0; i < p->worker_count; i++) {
+        free(p->workers[i].iterations);
+        free(p->workers[i].rgba);
+    }
+    for (int i = 0; p->entries && i < p->capacity; i++) {
+        free(p->entries[i].counts);
+        free(p->entries[i].rgba);
+    }
+
+    free(p->workers);
+    free(p->entries);
+    pthread_cond_destroy(&p->done);
+    pthread_cond_destroy(&p->work);
+    pthread_mutex_destroy(&p->lock);
+    free(p);
+}
+
+void mandel_prefetch_request(MandelPrefetch* p, const MandelbrotState* views, int count) {
+    pthread_mutex_lock(&p->lock);
+
+    // Cancel renders of views that are no longer wanted
+    for (int i = 0; i < p->thread_count; i++) {
+        Worker* w = &p->workers[i];
+        int wanted = 0;
+        for (int j = 0; j < count && !wanted; j++) {
+            wanted = same_view(&w->state, &views[j]);
+        }
+        if (w->busy && !wanted) atomic_store(&w->cancel, 1);
+    }
+
+    p->queued = 0;
+    for (int j = 0; j < count && p->queued < MANDEL_PREFETCH_QUEUE; j++) {
+        if (find_entry(p, &views[j]) || find_worker(p, &views[j])) continue;
+        p->queue[p->queued++] = views[j];
+    }
+    p->stats.requested += p->queued;
+
+    pthread_cond_broadcast(&p->work);
+    pthread_mutex_unlock(&p->lock);
+}
+
+int mandel_prefetch_lookup(MandelPrefetch* p, const MandelbrotState* state, int* iterations,
+                           uint8_t* rgba) {
+    pthread_mutex_lock(&p->lock);
+
+    // A render of this view that is already under way is cheaper to finish than to
+    // restart, unless its worker stops making progress
+    Worker* w = find_entry(p, state) ? NULL : find_worker(p, state);
+    if (w) raise_priority(w);
+    while (w) {
+        unsigned bands = atomic_load(&w->bands);
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += LOOKUP_STALL_NS;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        int status = 0;
+        while (status != ETIMEDOUT && !find_entry(p, state) && find_worker(p, state) == w) {
+            status = pthread_cond_timedwait(&p->done, &p->lock, &deadline);
+        }
+        w = find_entry(p, state) ? NULL : find_worker(p, state);
+        if (w && status == ETIMEDOUT && atomic_load(&w->bands) == bands) {
+            atomic_store(&w->cancel, 1);
+            w = NULL;
+        }
+    }
+
+    Entry* e = find_entry(p, state);
+    if (e && (!rgba || e->has_rgba)) {
+        size_t count = (size_t)p->width * p->height;
+        for (size_t i = 0; i < count; i++) {
+            iterations[i] = e->counts[i];
+        }
+        if (rgba) memcpy(rgba, e->rgba, count * 4);
+        e->last_used = ++p->clock;
+        p->stats.hits++;
+        pthread_mutex_unlock(&p->lock);
+        return 1;
+    }
+
+    // The caller renders it now, so no worker should start on it
+    for (int j = 0; j < p->queued; j++) {
+        if (same_view(&p->queue[j], state)) {
+            memmove(p->queue + j, p->queue + j + 1, (--p->queued - j) * sizeof(MandelbrotState));
+            break;
+        }
+    }
+    p->stats.misses++;
+    pthread_mutex_unlock(&p->lock);
+    return 0;
+}
+
+void mandel_prefetch_put(MandelPrefetch* p, const MandelbrotState* state, const int* iterations,
+                         const uint8_t* rgba) {
+    pthread_mutex_lock(&p->lock);
+    store(p, state, iterations, rgba);
+    pthread_mutex_unlock(&p->lock);
+}
+
+void mandel_prefetch_stats(MandelPrefetch* p, MandelPrefetchStats* stats) {
+    pthread_mutex_lock(&p->lock);
+    *stats = p->stats;
+    pthread_mutex_unlock(&p->lock);
+}
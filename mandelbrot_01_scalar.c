@@ -1,84 +1,22 @@
 #include <SFML/Graphics.h>
 #include <stdio.h>
-#include <math.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
+#include "libmandel/mandel.h"
 
-#define MAX_ITER 256
-#define ESCAPE_RADIUS 10.0
 #define WIDTH 800
 #define HEIGHT 600
-#define FILENAME "mandelbrot_saves.txt"
-
-typedef struct {
-    double center_x;
-    double center_y;
-    double scale;
-    int color_formula;
-} MandelbrotState;
 
 int graphics_enabled = 1;
-int run_count = 1;
-
-sfColor get_color(int iterations) {
-    if (iterations == MAX_ITER) {
-        return sfBlack;
-    } else {
-        float t = (float)iterations / MAX_ITER;
-        return sfColor_fromRGB(
-            (sfUint8)(9 * (1 - t) * t * t * t * 255),
-            (sfUint8)(15 * (1 - t) * (1 - t) * t * t * 255),
-            (sfUint8)(8.5 * (1 - t) * (1 - t) * (1 - t) * t * 255)
-        );
-    }
-}
-
-double compute_mandelbrot(sfUint8* pixels, const MandelbrotState* state) {
-    clock_t start = clock(); 
-    int* iterations = (int*) malloc(WIDTH * HEIGHT * sizeof(int)); 
-    
-    for (int y = 0; y < HEIGHT; y++) {
-        for (int x = 0; x < WIDTH; x++) {
-            double zx, zy;
-            double cx = state->center_x + (x - WIDTH / 2.0) * state->scale;
-            double cy = state->center_y + (y - HEIGHT / 2.0) * state->scale;
-            
-            int iter = 0;
-            
-            for (int r = 0; r < run_count; r++) {
-                zx = cx;
-                zy = cy;
-                iter = 0;
-                
-                while (iter < MAX_ITER) {
-                    double zx2 = zx * zx;
-                    double zy2 = zy * zy;
-                    if (zx2 + zy2 > ESCAPE_RADIUS * ESCAPE_RADIUS) break;
-                    zy = 2 * zx * zy + cy;
-                    zx = zx2 - zy2 + cx;
-                    iter++;
-                }
-
-                iterations[y * WIDTH + x] = iter;
-            }
-        }
-    }
-
-    clock_t end = clock();
-    double compute_time = (double)(end - start) / CLOCKS_PER_SEC;
-
-    if (graphics_enabled && pixels) {
-        for (int i = 0; i < WIDTH*HEIGHT; i++) {
-            sfColor color = get_color(iterations[i]);
-            pixels[4*i]   = color.r;
-            pixels[4*i+1] = color.g;
-            pixels[4*i+2] = color.b;
-            pixels[4*i+3] = 255;
-        }
-    }
-    free (iterations);
-    return compute_time;
+MandelOptions options;  // Render options passed to libmandel
+
+// Render a frame with the scalar kernel; pixels is NULL without graphics.
+// Returns the compute time in seconds, coloring not included.
+double compute_mandelbrot(MandelContext* ctx, sfUint8* pixels, int* iterations, const MandelbrotState* state) {
+    MandelImage image = {WIDTH, HEIGHT, {0, 0, 0, 0}, iterations, WIDTH, pixels, WIDTH * 4};
+    MandelStats stats;
+    if (mandel_render(ctx, state, &image, &stats) != MANDEL_OK) return 0.0;
+    return stats.compute_time;
 }
 
 void print_usage() {
@@ -86,6 +24,7 @@ void print_usage() {
     printf("  --graphics       Enable graphics mode (default)\n");
     printf("  --no-graphics    Disable graphics, compute only\n");
     printf("  --runs=N        Number of computation runs per point (default=1)\n");
+    printf("  --no-symmetry   Compute both halves instead of mirroring about the real axis\n");
 }
 
 int parse_args(int argc, char* argv[]) {
@@ -95,8 +34,10 @@ int parse_args(int argc, char* argv[]) {
         } else if (strcmp(argv[i], "--no-graphics") == 0) {
             graphics_enabled = 0;
         } else if (strncmp(argv[i], "--runs=", 7) == 0) {
-            run_count = atoi(argv[i] + 7);
-            if (run_count < 1) run_count = 1;
+            options.run_count = atoi(argv[i] + 7);
+            if (options.run_count < 1) options.run_count = 1;
+        } else if (strcmp(argv[i], "--no-symmetry") == 0) {
+            options.symmetry = 0;
         } else {
             printf("Unknown option: %s\n", argv[i]);
             print_usage();
@@ -107,10 +48,16 @@ int parse_args(int argc, char* argv[]) {
 }
 
 int main(int argc, char* argv[]) {
+    mandel_default_options(&options);
+    options.kernel = MANDEL_KERNEL_SCALAR;
     if (!parse_args(argc, argv)) {
         return 1;
     }
 
+    MandelContext* ctx = mandel_create(&options);
+    int* iterations = (int*) malloc(WIDTH * HEIGHT * sizeof(int));
+    if (!ctx || !iterations) return 1;
+
     sfRenderWindow* window = NULL;
     sfTexture* texture = NULL;
     sfSprite* sprite = NULL;
@@ -174,7 +121,7 @@ int main(int argc, char* argv[]) {
 
         frameCount++;
         
-        compute_time = compute_mandelbrot(pixels, &state);
+        compute_time = compute_mandelbrot(ctx, pixels, iterations, &state);
 
         if (graphics_enabled) {
             if (sfTime_asSeconds(sfClock_getElapsedTime(fpsClock)) >= 1.0f) {
@@ -183,7 +130,7 @@ int main(int argc, char* argv[]) {
                 sfClock_restart(fpsClock);
                 char fpsStr[64];
                 snprintf(fpsStr, sizeof(fpsStr), "FPS: %.0f (Runs: %d) | Compute: %.2fms", 
-                        fps, run_count, compute_time * 1000);
+                        fps, options.run_count, compute_time * 1000);
                 sfText_setString(fpsText, fpsStr);
             }
 
@@ -193,12 +140,14 @@ int main(int argc, char* argv[]) {
             sfRenderWindow_drawText(window, fpsText, NULL);  
             sfRenderWindow_display(window);
         } else {
-            printf("Completed %d runs per point\n", run_count);
+            printf("Completed %d runs per point\n", options.run_count);
             printf("Computation time: %.2f seconds\n", compute_time);
             break;
         }
     }
 
+    free(iterations);
+    mandel_destroy(ctx);
     if (graphics_enabled) {
         free(pixels);
         sfText_destroy(fpsText);
@@ -1,98 +1,22 @@
 #include <SFML/Graphics.h>
 #include <stdio.h>
-#include <math.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
+#include "libmandel/mandel.h"
 
-#define MAX_ITER 256
-#define ESCAPE_RADIUS 10.0
 #define WIDTH 800
 #define HEIGHT 600
-#define FILENAME "mandelbrot_saves.txt"
-
-typedef struct {
-    double center_x;
-    double center_y;
-    double scale;
-    int color_formula;
-} MandelbrotState;
 
 int graphics_enabled = 1;
-int run_count = 1;
-
-sfColor get_color(int iterations) {
-    if (iterations == MAX_ITER) {
-        return sfBlack;
-    } else {
-        float t = (float)iterations / MAX_ITER;
-        return sfColor_fromRGB(
-            (sfUint8)(9 * (1 - t) * t * t * t * 255),
-            (sfUint8)(15 * (1 - t) * (1 - t) * t * t * 255),
-            (sfUint8)(8.5 * (1 - t) * (1 - t) * (1 - t) * t * 255)
-        );
-    }
-}
-
-double compute_mandelbrot_optimized(sfUint8* pixels, const MandelbrotState* state) {
-    clock_t start = clock(); 
-    
-    int* iterations = (int*) malloc(WIDTH * HEIGHT * sizeof(int));
-    if (!iterations) return 0.0;
-
-    for (int r = 0; r < run_count; r++) {
-        for (int y = 0; y < HEIGHT; y++) {
-            for (int x = 0; x < WIDTH; x += 4) {
-                double cx[4], cy[4];
-                for (int k = 0; k < 4; k++) {
-                    cx[k] = state->center_x + (x + k - WIDTH/2.0) * state->scale;
-                    cy[k] = state->center_y + (y - HEIGHT/2.0) * state->scale;
-                }
-
-                double zx[4] = {0}, zy[4] = {0};
-                int iter[4] = {0};
-                int mask = 0;
-
-                for (int i = 0; i < MAX_ITER && mask != 0x0F; i++) {
-                    for (int k = 0; k < 4; k++) {
-                        if (mask & (1 << k)) continue;
-
-                        double zx2 = zx[k] * zx[k];
-                        double zy2 = zy[k] * zy[k];
-                        double zxzy = 2 * zx[k] * zy[k];
-
-                        zx[k] = zx2 - zy2 + cx[k];
-                        zy[k] = zxzy + cy[k];
-
-                        if (zx2 + zy2 > ESCAPE_RADIUS * ESCAPE_RADIUS) {
-                            mask |= (1 << k);
-                            iter[k] = i;
-                        }
-                    }
-                }
-
-                for (int k = 0; k < 4 && (x + k) < WIDTH; k++) {
-                    iterations[y*WIDTH + x + k] = iter[k];
-                }
-            }
-        }
-    }
-
-    clock_t end = clock(); 
-    double compute_time = (double)(end - start) / CLOCKS_PER_SEC;
-
-    if (graphics_enabled && pixels) {
-        for (int i = 0; i < WIDTH*HEIGHT; i++) {
-            sfColor color = get_color(iterations[i]);
-            pixels[4*i]   = color.r;
-            pixels[4*i+1] = color.g;
-            pixels[4*i+2] = color.b;
-            pixels[4*i+3] = 255;
-        }
-    }
-
-    free(iterations);
-    return compute_time;
+MandelOptions options;  // Render options passed to libmandel
+
+// Render a frame with the 4-pixel unrolled kernel; pixels is NULL without graphics.
+// Returns the compute time in seconds, coloring not included.
+double compute_mandelbrot_optimized(MandelContext* ctx, sfUint8* pixels, int* iterations, const MandelbrotState* state) {
+    MandelImage image = {WIDTH, HEIGHT, {0, 0, 0, 0}, iterations, WIDTH, pixels, WIDTH * 4};
+    MandelStats stats;
+    if (mandel_render(ctx, state, &image, &stats) != MANDEL_OK) return 0.0;
+    return stats.compute_time;
 }
 
 void print_usage() {
@@ -100,6 +24,7 @@ void print_usage() {
     printf("  --graphics       Enable graphics mode (default)\n");
     printf("  --no-graphics    Disable graphics, compute only\n");
     printf("  --runs=N        Number of computation runs per point (default=1)\n");
+    printf("  --no-symmetry   Compute both halves instead of mirroring about the real axis\n");
 }
 
 int parse_args(int argc, char* argv[]) {
@@ -109,8 +34,10 @@ int parse_args(int argc, char* argv[]) {
         } else if (strcmp(argv[i], "--no-graphics") == 0) {
             graphics_enabled = 0;
         } else if (strncmp(argv[i], "--runs=", 7) == 0) {
-            run_count = atoi(argv[i] + 7);
-            if (run_count < 1) run_count = 1;
+            options.run_count = atoi(argv[i] + 7);
+            if (options.run_count < 1) options.run_count = 1;
+        } else if (strcmp(argv[i], "--no-symmetry") == 0) {
+            options.symmetry = 0;
         } else {
             printf("Unknown option: %s\n", argv[i]);
             print_usage();
@@ -121,8 +48,14 @@ int parse_args(int argc, char* argv[]) {
 }
 
 int main(int argc, char* argv[]) {
+    mandel_default_options(&options);
+    options.kernel = MANDEL_KERNEL_UNROLL4;
     if (!parse_args(argc, argv)) return 1;
 
+    MandelContext* ctx = mandel_create(&options);
+    int* iterations = (int*) malloc(WIDTH * HEIGHT * sizeof(int));
+    if (!ctx || !iterations) return 1;
+
     sfRenderWindow* window = NULL;
     sfTexture* texture = NULL;
     sfSprite* sprite = NULL;
@@ -177,7 +110,7 @@ int main(int argc, char* argv[]) {
             }
         }
 
-        double compute_time = compute_mandelbrot_optimized(pixels, &state);
+        double compute_time = compute_mandelbrot_optimized(ctx, pixels, iterations, &state);
         frameCount++;
 
         if (graphics_enabled) {
@@ -187,7 +120,7 @@ int main(int argc, char* argv[]) {
                 sfClock_restart(fpsClock);
                 char fpsStr[64];
                 snprintf(fpsStr, sizeof(fpsStr), "FPS: %.1f | Compute: %.2fms (Runs: %d)",
-                        fps, compute_time*1000, run_count);
+                        fps, compute_time*1000, options.run_count);
                 sfText_setString(fpsText, fpsStr);
             }
 
@@ -197,11 +130,13 @@ int main(int argc, char* argv[]) {
             sfRenderWindow_drawText(window, fpsText, NULL);
             sfRenderWindow_display(window);
         } else {
-            printf("Compute time: %.3f sec (Runs: %d)\n", compute_time, run_count);
+            printf("Compute time: %.3f sec (Runs: %d)\n", compute_time, options.run_count);
             break;
         }
     }
 
+    free(iterations);
+    mandel_destroy(ctx);
     if (graphics_enabled) {
         free(pixels);
         sfText_destroy(fpsText);
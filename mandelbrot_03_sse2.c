@@ -1,110 +1,22 @@
 #include <SFML/Graphics.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <immintrin.h>
-#include <time.h>
 #include <string.h>
+#include "libmandel/mandel.h"
 
-#define MAX_ITER 256
-#define ESCAPE_RADIUS 10.0
 #define WIDTH 800
 #define HEIGHT 600
-#define FILENAME "mandelbrot_saves.txt"
-
-typedef struct {
-    double center_x;
-    double center_y;
-    double scale;
-    int color_formula;
-} MandelbrotState;
 
 int graphics_enabled = 1;
-int run_count = 1;
-
-sfColor get_color(int iterations) {
-    if (iterations == MAX_ITER) {
-        return sfBlack;
-    } else {
-        float t = (float)iterations / MAX_ITER;
-        return sfColor_fromRGB(
-            (sfUint8)(9 * (1 - t) * t * t * t * 255),
-            (sfUint8)(15 * (1 - t) * (1 - t) * t * t * 255),
-            (sfUint8)(8.5 * (1 - t) * (1 - t) * (1 - t) * t * 255)
-        );
-    }
-}
-
-double compute_mandelbrot_sse(sfUint8* pixels, const MandelbrotState* state) {
-    clock_t start = clock();
-    
-    int* iterations = (int*) malloc(WIDTH * HEIGHT * sizeof(int));
-    if (!iterations) return 0.0;
-
-    __m128d escape_radius = _mm_set1_pd(ESCAPE_RADIUS * ESCAPE_RADIUS);
-    __m128d scale = _mm_set1_pd(state->scale);
-    __m128d center_x = _mm_set1_pd(state->center_x);
-    __m128d center_y = _mm_set1_pd(state->center_y);
-    __m128d width_half = _mm_set1_pd(WIDTH / 2.0);
-    __m128d two = _mm_set1_pd(2.0);
-
-    for (int r = 0; r < run_count; r++) {
-        for (int y = 0; y < HEIGHT; y++) {
-            __m128d y_coord = _mm_set1_pd(y - HEIGHT / 2.0);
-            __m128d cy = _mm_add_pd(center_y, _mm_mul_pd(y_coord, scale));
-            
-            for (int x = 0; x < WIDTH; x += 2) {
-                __m128d x_coord = _mm_set_pd(x + 1, x);
-                __m128d cx = _mm_add_pd(center_x, 
-                              _mm_mul_pd(_mm_sub_pd(x_coord, width_half), scale));
-
-                __m128d zx = cx;
-                __m128d zy = cy;
-                __m128i iter = _mm_setzero_si128();
-                __m128i one = _mm_set1_epi64x(1);
-                int mask = 3;
-
-                for (int i = 0; i < MAX_ITER && mask; i++) {
-                    __m128d zx2 = _mm_mul_pd(zx, zx);
-                    __m128d zy2 = _mm_mul_pd(zy, zy);
-                    __m128d zxzy = _mm_mul_pd(_mm_mul_pd(zx, zy), two);
-
-                    zx = _mm_add_pd(_mm_sub_pd(zx2, zy2), cx);
-                    zy = _mm_add_pd(zxzy, cy);
-
-                    __m128d norm = _mm_add_pd(zx2, zy2);
-                    __m128d cmp = _mm_cmplt_pd(norm, escape_radius);
-                    mask = _mm_movemask_pd(cmp);
-
-                    __m128i inc = _mm_castpd_si128(cmp);
-                    iter = _mm_add_epi64(iter, _mm_and_si128(inc, one));
-                }
-
-                int iter_result[2];
-                _mm_storeu_si128((__m128i*)iter_result, iter);
-                
-                iterations[y * WIDTH + x] = iter_result[0];
-                if (x + 1 < WIDTH) {
-                    iterations[y * WIDTH + x + 1] = iter_result[1];
-                }
-            }
-        }
-    }
-
-    clock_t end = clock();
-    double compute_time = (double)(end - start) / CLOCKS_PER_SEC;
-
-    if (graphics_enabled && pixels) {
-        for (int i = 0; i < WIDTH * HEIGHT; i++) {
-            sfColor color = get_color(iterations[i]);
-            pixels[4*i] = color.r;
-            pixels[4*i+1] = color.g;
-            pixels[4*i+2] = color.b;
-            pixels[4*i+3] = 255;
-        }
-    }
-
-    free(iterations);
-    return compute_time;
+MandelOptions options;  // Render options passed to libmandel
+
+// Render a frame with the SSE2 kernel; pixels is NULL without graphics.
+// Returns the compute time in seconds, coloring not included.
+double compute_mandelbrot_sse(MandelContext* ctx, sfUint8* pixels, int* iterations, const MandelbrotState* state) {
+    MandelImage image = {WIDTH, HEIGHT, {0, 0, 0, 0}, iterations, WIDTH, pixels, WIDTH * 4};
+    MandelStats stats;
+    if (mandel_render(ctx, state, &image, &stats) != MANDEL_OK) return 0.0;
+    return stats.compute_time;
 }
 
 void print_usage() {
@@ -112,6 +24,10 @@ void print_usage() {
     printf("  --graphics       Enable graphics mode (default)\n");
     printf("  --no-graphics    Disable graphics, compute only\n");
     printf("  --runs=N        Number of computation runs per point (default=1)\n");
+    printf("  --no-symmetry   Compute both halves instead of mirroring about the real axis\n");
+    printf("  --smooth        Continuous coloring without iteration bands\n");
+    printf("  --julia=X,Y     Render the Julia set of c = X + iY instead of the Mandelbrot set\n");
+    printf("  --power=D       Iterate z^D + c, 2-%d (default=2)\n", MANDEL_MAX_POWER);
 }
 
 int parse_args(int argc, char* argv[]) {
@@ -121,8 +37,22 @@ int parse_args(int argc, char* argv[]) {
         } else if (strcmp(argv[i], "--no-graphics") == 0) {
             graphics_enabled = 0;
         } else if (strncmp(argv[i], "--runs=", 7) == 0) {
-            run_count = atoi(argv[i] + 7);
-            if (run_count < 1) run_count = 1;
+            options.run_count = atoi(argv[i] + 7);
+            if (options.run_count < 1) options.run_count = 1;
+        } else if (strcmp(argv[i], "--no-symmetry") == 0) {
+            options.symmetry = 0;
+        } else if (strcmp(argv[i], "--smooth") == 0) {
+            options.smooth = 1;
+        } else if (strncmp(argv[i], "--julia=", 8) == 0) {
+            if (sscanf(argv[i] + 8, "%lf,%lf", &options.julia_x, &options.julia_y) != 2) {
+                printf("Invalid Julia constant: %s (use --julia=X,Y)\n", argv[i] + 8);
+                return 0;
+            }
+            options.fractal = MANDEL_FRACTAL_JULIA;
+        } else if (strncmp(argv[i], "--power=", 8) == 0) {
+            options.power = atoi(argv[i] + 8);
+            if (options.power < 2) options.power = 2;
+            if (options.power > MANDEL_MAX_POWER) options.power = MANDEL_MAX_POWER;
         } else {
             printf("Unknown option: %s\n", argv[i]);
             print_usage();
@@ -133,8 +63,14 @@ int parse_args(int argc, char* argv[]) {
 }
 
 int main(int argc, char* argv[]) {
+    mandel_default_options(&options);
+    options.kernel = MANDEL_KERNEL_SSE2;
     if (!parse_args(argc, argv)) return 1;
 
+    MandelContext* ctx = mandel_create(&options);
+    int* iterations = (int*) malloc(WIDTH * HEIGHT * sizeof(int));
+    if (!ctx || !iterations) return 1;
+
     sfRenderWindow* window = NULL;
     sfTexture* texture = NULL;
     sfSprite* sprite = NULL;
@@ -166,7 +102,7 @@ int main(int argc, char* argv[]) {
         fpsClock = sfClock_create();
     }
 
-    MandelbrotState state = {-0.5, 0.0, 0.005, 0};
+    MandelbrotState state = {options.fractal == MANDEL_FRACTAL_JULIA ? 0.0 : -0.5, 0.0, 0.005, 0};
     int frameCount = 0;
     float fps = 0;
 
@@ -189,7 +125,7 @@ int main(int argc, char* argv[]) {
             }
         }
 
-        double compute_time = compute_mandelbrot_sse(pixels, &state);
+        double compute_time = compute_mandelbrot_sse(ctx, pixels, iterations, &state);
         frameCount++;
 
         if (graphics_enabled) {
@@ -199,7 +135,7 @@ int main(int argc, char* argv[]) {
                 sfClock_restart(fpsClock);
                 char fpsStr[64];
                 snprintf(fpsStr, sizeof(fpsStr), "FPS: %.1f | Compute: %.2fms (Runs: %d)",
-                        fps, compute_time*1000, run_count);
+                        fps, compute_time*1000, options.run_count);
                 sfText_setString(fpsText, fpsStr);
             }
 
@@ -209,11 +145,13 @@ int main(int argc, char* argv[]) {
             sfRenderWindow_drawText(window, fpsText, NULL);
             sfRenderWindow_display(window);
         } else {
-            printf("Compute time: %.3f sec (Runs: %d)\n", compute_time, run_count);
+            printf("Compute time: %.3f sec (Runs: %d)\n", compute_time, options.run_count);
             break;
         }
     }
 
+    free(iterations);
+    mandel_destroy(ctx);
     if (graphics_enabled) {
         free(pixels);
         sfText_destroy(fpsText);
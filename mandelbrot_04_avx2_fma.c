@@ -1,122 +1,275 @@
 #include <SFML/Graphics.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <immintrin.h>  // For AVX2 and FMA intrinsics
-#include <time.h>
 #include <string.h>
+#include <unistd.h>
+#include "libmandel/mandel.h"
 
-#define MAX_ITER 256    // Maximum iterations per pixel
-#define ESCAPE_RADIUS 10.0  // Escape radius squared
 #define WIDTH 800       // Window width
 #define HEIGHT 600      // Window height
 #define FILENAME "mandelbrot_saves.txt"
+#define MAX_BOOKMARKS 64
+#define BOOKMARK_NAME_LEN 64
+#define STREAM_THRESHOLD 0.05  // Stream bands once a render takes longer than this (sec)
+#define PREFETCH_MAX_THREADS 6  // One per neighbor view
+#define PREFETCH_CAPACITY 12    // Frames kept by the prefetch store (~2.9 MB each)
 
 typedef struct {
-    double center_x;     // X center coordinate
-    double center_y;     // Y center coordinate
-    double scale;       // Zoom scale factor
-    int color_formula;  // Color formula selector
-} MandelbrotState;
+    char name[BOOKMARK_NAME_LEN];
+    MandelbrotState state;
+    char cache_path[256];   // Cached iteration buffer, empty if none
+} Bookmark;
+
+// Pixel rectangle [x0, x1) x [y0, y1) awaiting texture upload, empty when x0 >= x1
+typedef struct {
+    int x0, y0;
+    int x1, y1;
+} DirtyRect;
 
 // Global flags
 int graphics_enabled = 1;
-int run_count = 1;
-
-// Convert iteration count to color
-sfColor get_color(int iterations) {
-    if (iterations == MAX_ITER) return sfBlack;
-    
-    // Smooth coloring algorithm
-    float t = (float)iterations / MAX_ITER;
-    return sfColor_fromRGB(
-        (sfUint8)(9 * (1-t) * t*t*t * 255),      // Red component
-        (sfUint8)(15 * (1-t)*(1-t) * t*t * 255), // Green component
-        (sfUint8)(8.5 * (1-t)*(1-t)*(1-t) * t * 255) // Blue component
-    );
+MandelOptions options;   // Render options passed to libmandel
+const char* start_bookmark = NULL;
+const char* save_name = NULL;
+int prewarm_mode = 0;
+int prefetch_threads = -1;  // Workers rendering neighbor views, -1 = one per spare core
+
+void dirty_add(DirtyRect* rect, int x0, int y0, int x1, int y1) {
+    if (rect->x0 >= rect->x1) {
+        *rect = (DirtyRect){x0, y0, x1, y1};
+        return;
+    }
+    if (x0 < rect->x0) rect->x0 = x0;
+    if (y0 < rect->y0) rect->y0 = y0;
+    if (x1 > rect->x1) rect->x1 = x1;
+    if (y1 > rect->y1) rect->y1 = y1;
+}
+
+// Apply a navigation key to state, returns 0 for other keys. Prefetching predicts
+// the next views with the same arithmetic, so a prefetched view compares equal.
+int move_view(MandelbrotState* state, sfKeyCode code) {
+    switch (code) {
+        case sfKeyZ: state->scale *= 0.5; break; // Zoom in
+        case sfKeyX: state->scale *= 2.0; break; // Zoom out
+        case sfKeyLeft:  state->center_x -= 50 * state->scale; break;
+        case sfKeyRight: state->center_x += 50 * state->scale; break;
+        case sfKeyUp:    state->center_y -= 50 * state->scale; break;
+        case sfKeyDown:  state->center_y += 50 * state->scale; break;
+        default: return 0;
+    }
+    return 1;
+}
+
+// Queue the views one keypress away from state; work on any other view is cancelled
+void prefetch_neighbors(MandelPrefetch* prefetch, const MandelbrotState* state) {
+    static const sfKeyCode keys[] = {sfKeyZ, sfKeyX, sfKeyLeft, sfKeyRight, sfKeyUp, sfKeyDown};
+    MandelbrotState views[6];
+    for (int k = 0; k < 6; k++) {
+        views[k] = *state;
+        move_view(&views[k], keys[k]);
+    }
+    mandel_prefetch_request(prefetch, views, 6);
+}
+
+// Achieved FLOP/cycle (TSC) of a render
+double flops_per_cycle(const MandelStats* stats) {
+    return stats->cycles ? stats->flops / stats->cycles : 0;
 }
 
-// Compute Mandelbrot set using AVX2 and FMA instructions
-double compute_mandelbrot_avx2(sfUint8* pixels, const MandelbrotState* state) {
-    clock_t start = clock();
-    
+// Compute a frame into iterations and, with graphics, colorize it into pixels.
+// Finished parts are reported to options.on_progress while computing.
+int compute_mandelbrot_avx2(MandelContext* ctx, sfUint8* pixels, int* iterations,
+                            const MandelbrotState* state, MandelStats* stats) {
+    MandelImage image = {WIDTH, HEIGHT, {0, 0, 0, 0}, iterations, WIDTH,
+                         graphics_enabled ? pixels : NULL, WIDTH * 4};
+    return mandel_render(ctx, state, &image, stats);
+}
+
+// Bookmark names double as cache file names, so keep them to [A-Za-z0-9_-]
+int valid_bookmark_name(const char* name) {
+    size_t len = strlen(name);
+    if (len == 0 || len >= BOOKMARK_NAME_LEN) return 0;
+    for (size_t i = 0; i < len; i++) {
+        char c = name[i];
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+              (c >= '0' && c <= '9') || c == '_' || c == '-')) return 0;
+    }
+    return 1;
+}
+
+// Read bookmarks from FILENAME, one "name center_x center_y scale formula cache" per line
+int load_bookmarks(Bookmark* bookmarks) {
+    FILE* file = fopen(FILENAME, "r");
+    if (!file) return 0;
+
+    int count = 0;
+    char line[512];
+    while (count < MAX_BOOKMARKS && fgets(line, sizeof(line), file)) {
+        Bookmark* bm = &bookmarks[count];
+        char cache[sizeof(bm->cache_path)];
+        if (sscanf(line, "%63s %lf %lf %lf %d %255s", bm->name,
+                   &bm->state.center_x, &bm->state.center_y, &bm->state.scale,
+                   &bm->state.color_formula, cache) != 6) continue;
+        if (!valid_bookmark_name(bm->name) || bm->state.scale <= 0) continue;
+        strcpy(bm->cache_path, strcmp(cache, "-") == 0 ? "" : cache);
+        count++;
+    }
+
+    fclose(file);
+    return count;
+}
+
+int save_bookmarks(const Bookmark* bookmarks, int count) {
+    FILE* file = fopen(FILENAME ".tmp", "w");
+    if (!file) return 0;
+
+    for (int i = 0; i < count; i++) {
+        const Bookmark* bm = &bookmarks[i];
+        fprintf(file, "%s %.17g %.17g %.17g %d %s\n", bm->name,
+                bm->state.center_x, bm->state.center_y, bm->state.scale,
+                bm->state.color_formula, bm->cache_path[0] ? bm->cache_path : "-");
+    }
+
+    if (fclose(file) != 0) return 0;
+    return rename(FILENAME ".tmp", FILENAME) == 0;
+}
+
+int find_bookmark(const Bookmark* bookmarks, int count, const char* name) {
+    for (int i = 0; i < count; i++) {
+        if (strcmp(bookmarks[i].name, name) == 0) return i;
+    }
+    return -1;
+}
+
+// Cache files are keyed by the view alone, so they only hold z^2 Mandelbrot counts
+int caches_valid(void) {
+    return options.fractal == MANDEL_FRACTAL_MANDELBROT && options.power == 2;
+}
+
+// Interpolated DE counts and --de-boundary set pixels are approximate, so they must not
+// be cached as if the view had been computed in full
+int counts_exact(void) {
+    return options.de_mode != MANDEL_DE_INTERPOLATE && !options.de_boundary;
+}
+
+// Add or replace a bookmark for state, caching its iterations when given
+int save_bookmark(const char* name, const MandelbrotState* state, const int* iterations) {
+    if (!valid_bookmark_name(name)) return 0;
+
+    Bookmark bookmarks[MAX_BOOKMARKS];
+    int count = load_bookmarks(bookmarks);
+    int index = find_bookmark(bookmarks, count, name);
+    if (index < 0) {
+        if (count == MAX_BOOKMARKS) return 0;
+        index = count++;
+    }
+
+    Bookmark* bm = &bookmarks[index];
+    snprintf(bm->name, sizeof(bm->name), "%s", name);
+    bm->state = *state;
+    bm->cache_path[0] = '\0';
+    if (iterations && caches_valid() && counts_exact()) {
+        snprintf(bm->cache_path, sizeof(bm->cache_path), "mandelbrot_cache_%s.bin", name);
+        if (!mandel_cache_write(bm->cache_path, state, WIDTH, HEIGHT, iterations)) bm->cache_path[0] = '\0';
+    }
+
+    return save_bookmarks(bookmarks, count);
+}
+
+// Batch tool: render and cache every bookmark that has no valid cached buffer
+int prewarm_bookmarks(void) {
+    if (!caches_valid()) {
+        printf("Cached buffers only hold the z^2 Mandelbrot set, drop --julia and --power\n");
+        return 0;
+    }
+
+    MandelOptions prewarm = options;
+    prewarm.de_mode = MANDEL_DE_OFF;
+    prewarm.de_boundary = 0;
+    prewarm.run_count = 1;
+
+    Bookmark bookmarks[MAX_BOOKMARKS];
+    int count = load_bookmarks(bookmarks);
+    MandelContext* ctx = mandel_create(&prewarm);
     int* iterations = (int*) malloc(WIDTH * HEIGHT * sizeof(int));
-    if (!iterations) return 0.0;
-
-    const __m256d escape_radius = _mm256_set1_pd(ESCAPE_RADIUS * ESCAPE_RADIUS);
-    const __m256d scale = _mm256_set1_pd(state->scale);
-    const __m256d width_half = _mm256_set1_pd(WIDTH / 2.0);
-    const __m256d height_half = _mm256_set1_pd(HEIGHT / 2.0);
-    const __m256d two = _mm256_set1_pd(2.0);
-
-    for (int r = 0; r < run_count; r++) {
-        for (int y = 0; y < HEIGHT; y++) {
-            double y_offset = (y - HEIGHT/2.0) * state->scale;
-            __m256d cy = _mm256_add_pd(_mm256_set1_pd(state->center_y), _mm256_set1_pd(y_offset));
-            
-            for (int x = 0; x < WIDTH; x += 4) {
-                __m256d x_coord = _mm256_set_pd(x+3, x+2, x+1, x);
-                __m256d cx = _mm256_add_pd(
-                    _mm256_set1_pd(state->center_x),
-                    _mm256_mul_pd(_mm256_sub_pd(x_coord, width_half), scale)
-                );
-
-                __m256d zx = cx;
-                __m256d zy = cy;
-                __m256d iter = _mm256_setzero_pd();
-                int mask = 0xF;
-
-                for (int i = 0; i < MAX_ITER && mask; i++) {
-                    __m256d zx2 = _mm256_mul_pd(zx, zx);
-                    __m256d zy2 = _mm256_mul_pd(zy, zy);
-                    __m256d xy  = _mm256_mul_pd(zx, zy);
-                    
-                    __m256d new_zx = _mm256_sub_pd(zx2, zy2);
-                    new_zx = _mm256_add_pd(new_zx, cx);
-                    
-                    __m256d new_zy = _mm256_fmadd_pd(xy, two, cy);
-                    
-                    zx = new_zx;
-                    zy = new_zy;
-
-                    __m256d norm = _mm256_add_pd(_mm256_mul_pd(zx, zx), _mm256_mul_pd(zy, zy));
-                    mask = _mm256_movemask_pd(_mm256_cmp_pd(norm, escape_radius, _CMP_LT_OS));
-                    
-                    __m256d mask_vec = _mm256_castsi256_pd(
-                        _mm256_setr_epi64x(
-                            (mask & 0x1) ? ~0ULL : 0,
-                            (mask & 0x2) ? ~0ULL : 0,
-                            (mask & 0x4) ? ~0ULL : 0,
-                            (mask & 0x8) ? ~0ULL : 0
-                        )
-                    );
-                    iter = _mm256_add_pd(iter, _mm256_and_pd(_mm256_set1_pd(1.0), mask_vec));
-                }
+    if (!ctx || !iterations) {
+        mandel_destroy(ctx);
+        free(iterations);
+        return 0;
+    }
 
-                double iter_result[4];
-                _mm256_storeu_pd(iter_result, iter);
-                
-                for (int k = 0; k < 4 && (x + k) < WIDTH; k++) {
-                    iterations[y*WIDTH + x + k] = (int)iter_result[k];
-                }
-            }
+    int warmed = 0;
+    for (int i = 0; i < count; i++) {
+        Bookmark* bm = &bookmarks[i];
+        if (bm->cache_path[0] && mandel_cache_read(bm->cache_path, &bm->state, WIDTH, HEIGHT, iterations)) {
+            printf("%-20s cached\n", bm->name);
+            continue;
         }
-    }                    
-
-    clock_t end = clock();
-    double compute_time = (double)(end - start) / CLOCKS_PER_SEC;
-
-    if (graphics_enabled && pixels) {
-        for (int i = 0; i < WIDTH * HEIGHT; i++) {
-            sfColor color = get_color(iterations[i]);
-            pixels[4*i]   = color.r;
-            pixels[4*i+1] = color.g;
-            pixels[4*i+2] = color.b;
-            pixels[4*i+3] = 255;
+
+        MandelStats stats;
+        if (mandel_render_iterations(ctx, &bm->state, WIDTH, HEIGHT, iterations, WIDTH, &stats) != MANDEL_OK) {
+            printf("%-20s failed to render\n", bm->name);
+            continue;
+        }
+        snprintf(bm->cache_path, sizeof(bm->cache_path), "mandelbrot_cache_%s.bin", bm->name);
+        if (!mandel_cache_write(bm->cache_path, &bm->state, WIDTH, HEIGHT, iterations)) {
+            printf("%-20s failed to write %s\n", bm->name, bm->cache_path);
+            bm->cache_path[0] = '\0';
+            continue;
         }
+        printf("%-20s rendered in %.3f sec\n", bm->name, stats.compute_time);
+        warmed++;
     }
-    
+
     free(iterations);
-    return compute_time;
+    mandel_destroy(ctx);
+    printf("Pre-warmed %d of %d bookmarks\n", warmed, count);
+    return save_bookmarks(bookmarks, count);
+}
+
+// Frame state the progress callback updates
+typedef struct {
+    sfRenderWindow* window;
+    sfTexture* texture;
+    sfSprite* sprite;
+    sfText* text;
+    const sfUint8* pixels;
+    sfUint8* scratch;       // Packing buffer for partial-width uploads
+    DirtyRect* dirty;
+    int stream;             // Show finished parts while the frame is still computing
+} Display;
+
+// Upload only the dirty part of the frame. Full-width rectangles are contiguous in
+// pixels; narrower ones are packed into scratch first.
+void upload_dirty(sfTexture* texture, const sfUint8* pixels, DirtyRect* dirty, sfUint8* scratch) {
+    if (dirty->x0 >= dirty->x1) return;
+
+    int w = dirty->x1 - dirty->x0;
+    int h = dirty->y1 - dirty->y0;
+    const sfUint8* src = pixels + 4 * (dirty->y0 * WIDTH + dirty->x0);
+    if (w < WIDTH) {
+        for (int y = 0; y < h; y++) {
+            memcpy(scratch + 4 * y * w, src + 4 * y * WIDTH, 4 * w);
+        }
+        src = scratch;
+    }
+    sfTexture_updateFromPixels(texture, src, w, h, dirty->x0, dirty->y0);
+    *dirty = (DirtyRect){0, 0, 0, 0};
+}
+
+// libmandel progress callback: collect finished rectangles for the next upload, or
+// draw them right away when streaming a long render
+int on_progress(const MandelRect* rect, void* user) {
+    Display* display = (Display*) user;
+    dirty_add(display->dirty, rect->x0, rect->y0, rect->x1, rect->y1);
+    if (display->stream) {
+        upload_dirty(display->texture, display->pixels, display->dirty, display->scratch);
+        sfRenderWindow_clear(display->window, sfBlack);
+        sfRenderWindow_drawSprite(display->window, display->sprite, NULL);
+        sfRenderWindow_drawText(display->window, display->text, NULL);
+        sfRenderWindow_display(display->window);
+    }
+    return 0;
 }
 
 void print_usage() {
@@ -125,9 +278,27 @@ void print_usage() {
     printf("  --graphics       Enable graphics mode (default)\n");
     printf("  --no-graphics    Disable graphics, compute only\n");
     printf("  --runs=N        Number of computation runs per point (default=1)\n");
+    printf("  --no-symmetry   Compute both halves instead of mirroring about the real axis\n");
+    printf("  --interleave=N  Advance N independent pixel groups per step, 1-%d (default=1)\n", MANDEL_MAX_INTERLEAVE);
+    printf("  --de[=exact]    Skip pixels inside distance-estimated exterior disks; their counts\n");
+    printf("                  are interpolated, or recomputed with the plain kernel for =exact.\n");
+    printf("                  Only pays off in sparse filament views; needs --interleave=1\n");
+    printf("  --de-boundary   With --de, draw points within half a pixel of the set as the set\n");
+    printf("  --aa            Anti-alias by supersampling edge pixels only\n");
+    printf("  --aa-threshold=N  Iteration difference that marks an edge (default=%d)\n", MANDEL_AA_THRESHOLD);
+    printf("  --smooth        Continuous coloring without iteration bands (with --de, only --de=exact)\n");
+    printf("  --julia=X,Y     Render the Julia set of c = X + iY instead of the Mandelbrot set\n");
+    printf("  --power=D       Iterate z^D + c, 2-%d (default=2)\n", MANDEL_MAX_POWER);
+    printf("  --bookmark=NAME Start at a saved bookmark (cached buffers show instantly)\n");
+    printf("  --save=NAME     Save the first rendered view as a bookmark with its buffer\n");
+    printf("  --prewarm       Render and cache every bookmark in %s, then exit\n", FILENAME);
+    printf("  --prefetch=N    Render the views one keypress away on N idle-priority threads\n");
+    printf("                  (default: spare cores up to %d, 0 = off)\n", PREFETCH_MAX_THREADS);
     printf("\nControls in graphics mode:\n");
     printf("  Z/X         Zoom in/out\n");
     printf("  Arrow keys  Move view\n");
+    printf("  S           Save current view as a bookmark\n");
+    printf("  1-9         Jump to bookmark N\n");
 }
 
 int parse_args(int argc, char* argv[]) {
@@ -137,25 +308,114 @@ int parse_args(int argc, char* argv[]) {
         } else if (strcmp(argv[i], "--no-graphics") == 0) {
             graphics_enabled = 0;
         } else if (strncmp(argv[i], "--runs=", 7) == 0) {
-            run_count = atoi(argv[i] + 7);
-            if (run_count < 1) run_count = 1;
+            options.run_count = atoi(argv[i] + 7);
+            if (options.run_count < 1) options.run_count = 1;
+        } else if (strcmp(argv[i], "--no-symmetry") == 0) {
+            options.symmetry = 0;
+        } else if (strncmp(argv[i], "--interleave=", 13) == 0) {
+            options.interleave = atoi(argv[i] + 13);
+            if (options.interleave < 1) options.interleave = 1;
+            if (options.interleave > MANDEL_MAX_INTERLEAVE) options.interleave = MANDEL_MAX_INTERLEAVE;
+        } else if (strcmp(argv[i], "--de") == 0) {
+            options.de_mode = MANDEL_DE_INTERPOLATE;
+        } else if (strcmp(argv[i], "--de=exact") == 0) {
+            options.de_mode = MANDEL_DE_EXACT;
+        } else if (strcmp(argv[i], "--de-boundary") == 0) {
+            options.de_boundary = 1;
+        } else if (strcmp(argv[i], "--aa") == 0) {
+            options.aa = 1;
+        } else if (strncmp(argv[i], "--aa-threshold=", 15) == 0) {
+            options.aa_threshold = atoi(argv[i] + 15);
+            if (options.aa_threshold < 0) options.aa_threshold = 0;
+        } else if (strcmp(argv[i], "--smooth") == 0) {
+            options.smooth = 1;
+        } else if (strncmp(argv[i], "--julia=", 8) == 0) {
+            if (sscanf(argv[i] + 8, "%lf,%lf", &options.julia_x, &options.julia_y) != 2) {
+                printf("Invalid Julia constant: %s (use --julia=X,Y)\n", argv[i] + 8);
+                return 0;
+            }
+            options.fractal = MANDEL_FRACTAL_JULIA;
+        } else if (strncmp(argv[i], "--power=", 8) == 0) {
+            options.power = atoi(argv[i] + 8);
+            if (options.power < 2) options.power = 2;
+            if (options.power > MANDEL_MAX_POWER) options.power = MANDEL_MAX_POWER;
+        } else if (strncmp(argv[i], "--bookmark=", 11) == 0) {
+            start_bookmark = argv[i] + 11;
+        } else if (strncmp(argv[i], "--save=", 7) == 0) {
+            save_name = argv[i] + 7;
+            if (!valid_bookmark_name(save_name)) {
+                printf("Invalid bookmark name: %s (use letters, digits, '_' and '-')\n", save_name);
+                return 0;
+            }
+        } else if (strcmp(argv[i], "--prewarm") == 0) {
+            prewarm_mode = 1;
+        } else if (strncmp(argv[i], "--prefetch=", 11) == 0) {
+            prefetch_threads = atoi(argv[i] + 11);
+            if (prefetch_threads < 0) prefetch_threads = 0;
+            if (prefetch_threads > PREFETCH_MAX_THREADS) prefetch_threads = PREFETCH_MAX_THREADS;
         } else {
             printf("Unknown option: %s\n", argv[i]);
             print_usage();
             return 0;
         }
     }
+
+    // Interpolated pixels have no escape |z| to color from
+    if (options.smooth && options.de_mode == MANDEL_DE_INTERPOLATE) {
+        printf("--smooth needs --de=exact\n");
+        return 0;
+    }
+    // The distance-estimator kernel advances one pixel group at a time
+    if (options.interleave > 1 && options.de_mode != MANDEL_DE_OFF) {
+        printf("--de needs --interleave=1\n");
+        return 0;
+    }
+    // The distance-estimator kernels only iterate z^2 + c
+    if (!caches_valid() && options.de_mode != MANDEL_DE_OFF) {
+        printf("--julia and --power need no --de\n");
+        return 0;
+    }
     return 1;
 }
 
 int main(int argc, char* argv[]) {
+    mandel_default_options(&options);
+    options.kernel = MANDEL_KERNEL_AVX2;
     if (!parse_args(argc, argv)) return 1;
+    if (prewarm_mode) return prewarm_bookmarks() ? 0 : 1;
+
+    // Initial Mandelbrot state; Julia sets are centered on the origin
+    MandelbrotState state = {options.fractal == MANDEL_FRACTAL_JULIA ? 0.0 : -0.5, 0.0, 0.005, 0};
+    char pending_cache[256] = "";   // Cached buffer to try before computing the next frame
+    char status[96] = "";
+
+    if (start_bookmark) {
+        Bookmark bookmarks[MAX_BOOKMARKS];
+        int count = load_bookmarks(bookmarks);
+        int index = find_bookmark(bookmarks, count, start_bookmark);
+        if (index < 0) {
+            printf("Bookmark not found in %s: %s\n", FILENAME, start_bookmark);
+            return 1;
+        }
+        state = bookmarks[index].state;
+        strcpy(pending_cache, bookmarks[index].cache_path);
+    }
+
+    MandelContext* ctx = mandel_create(&options);
+    if (!ctx) {
+        printf("AVX2 and FMA are not supported on this CPU\n");
+        return 1;
+    }
+
+    int* iterations = (int*) malloc(WIDTH * HEIGHT * sizeof(int));
+    if (!iterations) return 1;
 
     // Initialize SFML objects
     sfRenderWindow* window = NULL;
     sfTexture* texture = NULL;
     sfSprite* sprite = NULL;
     sfUint8* pixels = NULL;
+    sfUint8* scratch = NULL;    // Packing buffer for partial-width uploads
     sfFont* font = NULL;
     sfText* fpsText = NULL;
     sfClock* fpsClock = NULL;
@@ -178,7 +438,8 @@ int main(int argc, char* argv[]) {
 
         // Pixel buffer (RGBA format)
         pixels = (sfUint8*) malloc(WIDTH * HEIGHT * 4);
-        if (!pixels) return 1;
+        scratch = (sfUint8*) malloc(WIDTH * HEIGHT * 4);
+        if (!pixels || !scratch) return 1;
         memset(pixels, 0, WIDTH * HEIGHT * 4);
 
         // FPS counter setup
@@ -192,10 +453,32 @@ int main(int argc, char* argv[]) {
         fpsClock = sfClock_create();
     }
 
-    // Initial Mandelbrot state
-    MandelbrotState state = {-0.5, 0.0, 0.005, 0};
     int frameCount = 0;
     float fps = 0;
+    double compute_time = 0;
+    int needs_render = 1;   // The view changed since the last computed frame
+    DirtyRect dirty = {0, 0, 0, 0};
+    Display display = {window, texture, sprite, fpsText, pixels, scratch, &dirty, 0};
+    MandelStats stats = {0};
+
+    MandelPrefetch* prefetch = NULL;
+
+    if (graphics_enabled) {
+        // Workers get their own copy of the options, before the display callback is set
+        if (prefetch_threads < 0) {
+            long cores = sysconf(_SC_NPROCESSORS_ONLN) - 1;
+            prefetch_threads = cores < 1 ? 1 : cores > PREFETCH_MAX_THREADS ? PREFETCH_MAX_THREADS : (int) cores;
+        }
+        if (prefetch_threads > 0) {
+            prefetch = mandel_prefetch_create(&options, WIDTH, HEIGHT, prefetch_threads,
+                                              PREFETCH_CAPACITY, 1);
+        }
+
+        // Finished parts of the frame are tracked through the progress callback
+        options.on_progress = on_progress;
+        options.user = &display;
+        mandel_set_options(ctx, &options);
+    }
 
     // Main loop
     while (graphics_enabled ? sfRenderWindow_isOpen(window) : frameCount < 1) {
@@ -206,21 +489,77 @@ int main(int argc, char* argv[]) {
                 if (event.type == sfEvtClosed)
                     sfRenderWindow_close(window);
                 if (event.type == sfEvtKeyPressed) {
+                    if (move_view(&state, event.key.code)) {
+                        needs_render = 1;
+                        continue;
+                    }
                     switch (event.key.code) {
-                        case sfKeyZ: state.scale *= 0.5; break; // Zoom in
-                        case sfKeyX: state.scale *= 2.0; break; // Zoom out
-                        case sfKeyLeft:  state.center_x -= 50 * state.scale; break;
-                        case sfKeyRight: state.center_x += 50 * state.scale; break;
-                        case sfKeyUp:    state.center_y -= 50 * state.scale; break;
-                        case sfKeyDown:  state.center_y += 50 * state.scale; break;
-                        default: break;
+                        case sfKeyS: {
+                            // Until the view is rendered, iterations holds another view's counts
+                            Bookmark bookmarks[MAX_BOOKMARKS];
+                            char name[BOOKMARK_NAME_LEN];
+                            snprintf(name, sizeof(name), "view%d", load_bookmarks(bookmarks) + 1);
+                            snprintf(status, sizeof(status),
+                                     save_bookmark(name, &state, needs_render ? NULL : iterations) ?
+                                     "Saved bookmark %s" : "Failed to save %s", name);
+                            break;
+                        }
+                        default:
+                            if (event.key.code >= sfKeyNum1 && event.key.code <= sfKeyNum9) {
+                                Bookmark bookmarks[MAX_BOOKMARKS];
+                                int index = event.key.code - sfKeyNum1;
+                                if (index < load_bookmarks(bookmarks)) {
+                                    state = bookmarks[index].state;
+                                    strcpy(pending_cache, bookmarks[index].cache_path);
+                                    snprintf(status, sizeof(status), "Bookmark %s", bookmarks[index].name);
+                                    needs_render = 1;
+                                }
+                            }
+                            break;
                     }
                 }
             }
         }
 
-        // Compute Mandelbrot set and measure time
-        double compute_time = compute_mandelbrot_avx2(pixels, &state);
+        // Compute Mandelbrot set and measure time, unless a cached buffer matches the view
+        if (needs_render) {
+            int loaded = 0;
+            // Cached counts color like a plain render, so AA and smooth views are rendered
+            int cache_usable = caches_valid() && !options.aa && !options.smooth;
+            if (pending_cache[0] && cache_usable && mandel_cache_read(pending_cache, &state, WIDTH, HEIGHT, iterations)) {
+                if (pixels) {
+                    mandel_colorize(iterations, WIDTH, WIDTH, HEIGHT, pixels, WIDTH * 4);
+                    dirty_add(&dirty, 0, 0, WIDTH, HEIGHT);
+                }
+                strcat(status, status[0] ? " (cached)" : "Loaded from cache");
+                loaded = 1;
+            } else if (prefetch && mandel_prefetch_lookup(prefetch, &state, iterations, pixels)) {
+                dirty_add(&dirty, 0, 0, WIDTH, HEIGHT);
+                loaded = 1;
+            }
+
+            if (prefetch) prefetch_neighbors(prefetch, &state);
+
+            if (loaded) {
+                compute_time = 0;
+                stats = (MandelStats){0};
+            } else {
+                // Renders that took long last time stream row bands as they finish
+                display.stream = compute_time > STREAM_THRESHOLD;
+                compute_mandelbrot_avx2(ctx, pixels, iterations, &state, &stats);
+                compute_time = stats.compute_time;
+                if (prefetch) mandel_prefetch_put(prefetch, &state, iterations, pixels);
+            }
+            pending_cache[0] = '\0';
+            needs_render = 0;
+
+            if (save_name) {
+                if (!save_bookmark(save_name, &state, iterations)) {
+                    printf("Failed to save bookmark %s\n", save_name);
+                }
+                save_name = NULL;
+            }
+        }
         frameCount++;
 
         if (graphics_enabled) {
@@ -230,32 +569,54 @@ int main(int argc, char* argv[]) {
                 frameCount = 0;
                 sfClock_restart(fpsClock);
                 
+                char prefetchStr[64] = "";
+                if (prefetch) {
+                    MandelPrefetchStats ps;
+                    mandel_prefetch_stats(prefetch, &ps);
+                    snprintf(prefetchStr, sizeof(prefetchStr), " | Prefetch hits: %llu/%llu",
+                             (unsigned long long) ps.hits, (unsigned long long) (ps.hits + ps.misses));
+                }
+
                 // Update FPS text
-                char fpsStr[128];
+                char fpsStr[320];
                 snprintf(fpsStr, sizeof(fpsStr), 
-                        "FPS: %.1f | Compute: %.2fms (Runs: %d)\n"
-                        "Pos: (%.5f, %.5f) | Scale: %.2e",
-                        fps, compute_time*1000, run_count,
-                        state.center_x, state.center_y, state.scale);
+                        "FPS: %.1f | Compute: %.2fms (Runs: %d) | %.2f FLOP/cycle\n"
+                        "Pos: (%.5f, %.5f) | Scale: %.2e%s\n%s",
+                        fps, compute_time*1000, options.run_count, flops_per_cycle(&stats),
+                        state.center_x, state.center_y, state.scale, prefetchStr, status);
                 sfText_setString(fpsText, fpsStr);
             }
 
-            // Update texture and render
-            sfTexture_updateFromPixels(texture, pixels, WIDTH, HEIGHT, 0, 0);
+            // Upload what changed and render
+            upload_dirty(texture, pixels, &dirty, scratch);
             sfRenderWindow_clear(window, sfBlack);
             sfRenderWindow_drawSprite(window, sprite, NULL);
             sfRenderWindow_drawText(window, fpsText, NULL);
             sfRenderWindow_display(window);
         } else {
             // In non-graphics mode, just print timing information
-            printf("Compute time: %.3f sec (Runs: %d)\n", compute_time, run_count);
+            printf("Compute time: %.3f sec (Runs: %d)\n", compute_time, options.run_count);
+            printf("Interleave: %d | %.2f FLOP/cycle\n", options.interleave, flops_per_cycle(&stats));
+            if (options.de_mode != MANDEL_DE_OFF) {
+                printf("DE skipped pixels: %d (%.1f%%)\n",
+                       stats.de_skipped, 100.0 * stats.de_skipped / (WIDTH * HEIGHT));
+            }
+            if (options.aa) {
+                printf("AA edge pixels: %d (%.1f%%)\n",
+                       stats.aa_edge_count, 100.0 * stats.aa_edge_count / (WIDTH * HEIGHT));
+            }
+            if (status[0]) printf("%s\n", status);
             break;
         }
     }
 
     // Cleanup
+    mandel_prefetch_destroy(prefetch);
+    free(iterations);
+    mandel_destroy(ctx);
     if (graphics_enabled) {
         free(pixels);
+        free(scratch);
         sfText_destroy(fpsText);
         sfFont_destroy(font);
         sfClock_destroy(fpsClock);
@@ -265,4 +626,4 @@ int main(int argc, char* argv[]) {
     }
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,370 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include "libmandel/mandel.h"
+
+#define MAX_SIZE 16384          // Largest accepted image side
+#define TILE_ROWS 16            // Default rows per tile
+#define PATH_LEN 512
+
+// One image: a record of the job list and the pooled buffer it renders into
+typedef struct Job {
+    MandelbrotState state;
+    int width, height;
+    char path[PATH_LEN];
+    uint8_t* rgba;
+    size_t capacity;            // Bytes allocated for rgba, kept between jobs
+    int next_row;               // First row not yet handed to a worker
+    int tiles_left;             // Tiles not finished yet
+    int failed;
+    struct Job* next;           // Render queue, write queue or free list
+} Job;
+
+// Shared state of the render workers, the writer and the reader (main thread)
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t work;        // Tiles queued or input finished
+    pthread_cond_t finished;    // A job is ready to write or input finished
+    pthread_cond_t released;    // A buffer went back to the pool
+    Job* render_head;           // Jobs with tiles not handed out yet
+    Job* render_tail;
+    Job* write_head;            // Fully rendered jobs
+    Job* write_tail;
+    Job* free_list;
+    int in_flight;              // Jobs submitted and not written yet
+    int input_done;
+
+    int written;
+    int failed;
+    double megapixels;
+} Batch;
+
+// Global flags
+MandelOptions options;          // Render options passed to libmandel
+int thread_count = 0;           // 0 = one per core
+int tile_rows = TILE_ROWS;
+int buffer_count = 0;           // Images in flight, 0 = two per thread
+const char* out_dir = ".";
+const char* job_path = NULL;    // NULL or "-" reads stdin
+
+static double wall_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void push(Job** head, Job** tail, Job* job) {
+    job->next = NULL;
+    if (*tail) (*tail)->next = job;
+    else *head = job;
+    *tail = job;
+}
+
+// Binary PPM, the alpha channel is dropped row by row into row
+static int write_ppm(const Job* job, uint8_t* row) {
+    FILE* file = fopen(job->path, "wb");
+    if (!file) return 0;
+
+    int ok = fprintf(file, "P6\n%d %d\n255\n", job->width, job->height) > 0;
+    for (int y = 0; ok && y < job->height; y++) {
+        const uint8_t* src = job->rgba + (size_t)y * job->width * 4;
+        for (int x = 0; x < job->width; x++) {
+            memcpy(row + 3*x, src + 4*x, 3);
+        }
+        ok = fwrite(row, 3, job->width, file) == (size_t) job->width;
+    }
+    return (fclose(file) == 0) && ok;
+}
+
+// Render tiles of whichever job is at the head of the queue, so workers move on to
+// the next job while the last tiles of the previous one are still being computed
+static void* render_worker(void* arg) {
+    Batch* batch = (Batch*) arg;
+    MandelContext* ctx = mandel_create(&options);
+
+    pthread_mutex_lock(&batch->lock);
+    for (;;) {
+        while (!batch->render_head && !batch->input_done) {
+            pthread_cond_wait(&batch->work, &batch->lock);
+        }
+        Job* job = batch->render_head;
+        if (!job) break;
+
+        int y0 = job->next_row;
+        int y1 = y0 + tile_rows < job->height ? y0 + tile_rows : job->height;
+        job->next_row = y1;
+        if (y1 == job->height) {
+            batch->render_head = job->next;
+            if (!batch->render_head) batch->render_tail = NULL;
+        }
+        pthread_mutex_unlock(&batch->lock);
+
+        MandelImage image = {job->width, job->height, {0, y0, job->width, y1},
+                             NULL, 0, job->rgba + (size_t)y0 * job->width * 4, (size_t)job->width * 4};
+        int status = ctx ? mandel_render(ctx, &job->state, &image, NULL) : MANDEL_ERR_NOMEM;
+
+        pthread_mutex_lock(&batch->lock);
+        if (status != MANDEL_OK) job->failed = 1;
+        if (--job->tiles_left == 0) {
+            push(&batch->write_head, &batch->write_tail, job);
+            pthread_cond_signal(&batch->finished);
+        }
+    }
+    pthread_mutex_unlock(&batch->lock);
+
+    mandel_destroy(ctx);
+    return NULL;
+}
+
+// Write finished images in completion order and return their buffers to the pool
+static void* write_worker(void* arg) {
+    Batch* batch = (Batch*) arg;
+    uint8_t* row = (uint8_t*) malloc(MAX_SIZE * 3);
+
+    pthread_mutex_lock(&batch->lock);
+    for (;;) {
+        while (!batch->write_head && !(batch->input_done && batch->in_flight == 0)) {
+            pthread_cond_wait(&batch->finished, &batch->lock);
+        }
+        Job* job = batch->write_head;
+        if (!job) break;
+        batch->write_head = job->next;
+        if (!batch->write_head) batch->write_tail = NULL;
+        pthread_mutex_unlock(&batch->lock);
+
+        int ok = !job->failed && row && write_ppm(job, row);
+        if (!ok) fprintf(stderr, "Failed to %s %s\n", job->failed ? "render" : "write", job->path);
+
+        pthread_mutex_lock(&batch->lock);
+        if (ok) {
+            batch->written++;
+            batch->megapixels += job->width * (double) job->height * 1e-6;
+        } else {
+            batch->failed++;
+        }
+        batch->in_flight--;
+        job->next = batch->free_list;
+        batch->free_list = job;
+        pthread_cond_signal(&batch->released);
+    }
+    pthread_mutex_unlock(&batch->lock);
+
+    free(row);
+    return NULL;
+}
+
+// Parse "center_x center_y scale size [name]", size is N or WxH. Returns 1 for a job,
+// 0 for a blank or comment line and -1 for a malformed record.
+static int parse_job(const char* line, int index, Job* job) {
+    char first = line[strspn(line, " \t\r\n")];
+    if (first == '\0' || first == '#') return 0;
+
+    char size[32], name[256] = "";
+    int fields = sscanf(line, "%lf %lf %lf %31s %255s", &job->state.center_x, &job->state.center_y,
+                        &job->state.scale, size, name);
+    if (fields < 4 || !(job->state.scale > 0)) return -1;
+
+    char* end;
+    job->width = (int) strtol(size, &end, 10);
+    job->height = job->width;
+    if (*end == 'x') job->height = (int) strtol(end + 1, &end, 10);
+    if (*end || job->width <= 0 || job->height <= 0 ||
+        job->width > MAX_SIZE || job->height > MAX_SIZE) {
+        return -1;
+    }
+
+    job->state.color_formula = 0;
+    if (name[0]) snprintf(job->path, PATH_LEN, "%s/%s", out_dir, name);
+    else snprintf(job->path, PATH_LEN, "%s/%06d.ppm", out_dir, index);
+    return 1;
+}
+
+void print_usage() {
+    printf("Usage: mandelbrot_batch [options] [JOBFILE]\n");
+    printf("Renders one PPM per record of JOBFILE (stdin if absent or '-'). Records are\n");
+    printf("'center_x center_y scale size [name]' with size N or WxH; '#' starts a comment.\n");
+    printf("  --threads=N     Render threads (default: one per core)\n");
+    printf("  --tile-rows=N   Rows per scheduled tile (default=%d)\n", TILE_ROWS);
+    printf("  --buffers=N     Images in flight, rendering or writing (default: 2 per thread)\n");
+    printf("  --out=DIR       Output directory (default: current)\n");
+    printf("  --kernel=NAME   scalar, unroll4, sse2 or avx2 (default: fastest available)\n");
+    printf("  --smooth        Continuous coloring without iteration bands (sse2, avx2)\n");
+    printf("  --julia=X,Y     Render the Julia set of c = X + iY (sse2, avx2)\n");
+    printf("  --power=D       Iterate z^D + c, 2-%d (default=2, sse2 and avx2 above 2)\n", MANDEL_MAX_POWER);
+    printf("  --aa            Anti-alias by supersampling edge pixels only\n");
+}
+
+int parse_args(int argc, char* argv[]) {
+    static const char* kernels[] = {"scalar", "unroll4", "sse2", "avx2"};
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--threads=", 10) == 0) {
+            thread_count = atoi(argv[i] + 10);
+            if (thread_count < 1) thread_count = 1;
+        } else if (strncmp(argv[i], "--tile-rows=", 12) == 0) {
+            tile_rows = atoi(argv[i] + 12);
+            if (tile_rows < 1) tile_rows = 1;
+        } else if (strncmp(argv[i], "--buffers=", 10) == 0) {
+            buffer_count = atoi(argv[i] + 10);
+            if (buffer_count < 1) buffer_count = 1;
+        } else if (strncmp(argv[i], "--out=", 6) == 0) {
+            out_dir = argv[i] + 6;
+        } else if (strncmp(argv[i], "--kernel=", 9) == 0) {
+            int k = 0;
+            while (k < 4 && strcmp(argv[i] + 9, kernels[k]) != 0) k++;
+            if (k == 4) {
+                printf("Unknown kernel: %s\n", argv[i] + 9);
+                return 0;
+            }
+            options.kernel = (MandelKernel) k;
+        } else if (strcmp(argv[i], "--smooth") == 0) {
+            options.smooth = 1;
+        } else if (strncmp(argv[i], "--julia=", 8) == 0) {
+            if (sscanf(argv[i] + 8, "%lf,%lf", &options.julia_x, &options.julia_y) != 2) {
+                printf("Invalid Julia constant: %s (use --julia=X,Y)\n", argv[i] + 8);
+                return 0;
+            }
+            options.fractal = MANDEL_FRACTAL_JULIA;
+        } else if (strncmp(argv[i], "--power=", 8) == 0) {
+            options.power = atoi(argv[i] + 8);
+            if (options.power < 2) options.power = 2;
+            if (options.power > MANDEL_MAX_POWER) options.power = MANDEL_MAX_POWER;
+        } else if (strcmp(argv[i], "--aa") == 0) {
+            options.aa = 1;
+        } else if (argv[i][0] != '-' || strcmp(argv[i], "-") == 0) {
+            job_path = argv[i];
+        } else {
+            printf("Unknown option: %s\n", argv[i]);
+            print_usage();
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int main(int argc, char* argv[]) {
+    mandel_default_options(&options);
+    if (!parse_args(argc, argv)) return 1;
+
+    // Every worker creates its own context; check once that these options can run here
+    MandelContext* probe = mandel_create(&options);
+    if (!probe) {
+        printf("The selected kernel or options are not supported on this CPU\n");
+        return 1;
+    }
+    mandel_destroy(probe);
+
+    FILE* input = stdin;
+    if (job_path && strcmp(job_path, "-") != 0) {
+        input = fopen(job_path, "r");
+        if (!input) {
+            printf("Cannot open %s\n", job_path);
+            return 1;
+        }
+    }
+
+    if (thread_count < 1) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        thread_count = cores > 0 ? (int) cores : 1;
+    }
+    if (buffer_count < 1) buffer_count = 2 * thread_count;
+
+    Batch batch = {0};
+    pthread_mutex_init(&batch.lock, NULL);
+    pthread_cond_init(&batch.work, NULL);
+    pthread_cond_init(&batch.finished, NULL);
+    pthread_cond_init(&batch.released, NULL);
+
+    // Buffers are reused by later jobs and only grow
+    Job* jobs = (Job*) calloc(buffer_count, sizeof(Job));
+    pthread_t* threads = (pthread_t*) malloc(thread_count * sizeof(pthread_t));
+    if (!jobs || !threads) return 1;
+    for (int i = buffer_count - 1; i >= 0; i--) {
+        jobs[i].next = batch.free_list;
+        batch.free_list = &jobs[i];
+    }
+
+    pthread_t writer;
+    double start = wall_seconds();
+    pthread_create(&writer, NULL, write_worker, &batch);
+    for (int i = 0; i < thread_count; i++) {
+        pthread_create(&threads[i], NULL, render_worker, &batch);
+    }
+
+    // Read records as they arrive, so a stream on stdin starts rendering immediately
+    char line[1024];
+    int line_number = 0, index = 0, rejected = 0;
+    while (fgets(line, sizeof(line), input)) {
+        line_number++;
+
+        pthread_mutex_lock(&batch.lock);
+        while (!batch.free_list) pthread_cond_wait(&batch.released, &batch.lock);
+        Job* job = batch.free_list;
+        batch.free_list = job->next;
+        pthread_mutex_unlock(&batch.lock);
+
+        int parsed = parse_job(line, index, job);
+        size_t size = parsed > 0 ? (size_t)job->width * job->height * 4 : 0;
+        if (size > job->capacity) {
+            free(job->rgba);
+            job->rgba = (uint8_t*) malloc(size);
+            job->capacity = job->rgba ? size : 0;
+            if (!job->rgba) parsed = -1;
+        }
+
+        pthread_mutex_lock(&batch.lock);
+        if (parsed > 0) {
+            job->next_row = 0;
+            job->tiles_left = (job->height + tile_rows - 1) / tile_rows;
+            job->failed = 0;
+            push(&batch.render_head, &batch.render_tail, job);
+            batch.in_flight++;
+            pthread_cond_broadcast(&batch.work);
+            index++;
+        } else {
+            job->next = batch.free_list;
+            batch.free_list = job;
+        }
+        pthread_mutex_unlock(&batch.lock);
+
+        if (parsed < 0) {
+            fprintf(stderr, "Skipping line %d: %s", line_number, line);
+            rejected++;
+        }
+    }
+
+    pthread_mutex_lock(&batch.lock);
+    batch.input_done = 1;
+    pthread_cond_broadcast(&batch.work);
+    pthread_cond_broadcast(&batch.finished);
+    pthread_mutex_unlock(&batch.lock);
+
+    for (int i = 0; i < thread_count; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_join(writer, NULL);
+    double elapsed = wall_seconds() - start;
+
+    printf("Rendered %d images (%.1f Mpixel) in %.3f sec on %d threads\n",
+           batch.written, batch.megapixels, elapsed, thread_count);
+    printf("Throughput: %.1f images/s, %.1f Mpixel/s\n",
+           batch.written / elapsed, batch.megapixels / elapsed);
+    if (batch.failed || rejected) printf("Failed: %d, skipped records: %d\n", batch.failed, rejected);
+
+    // Cleanup
+    if (input != stdin) fclose(input);
+    for (int i = 0; i < buffer_count; i++) {
+        free(jobs[i].rgba);
+    }
+    free(jobs);
+    free(threads);
+    pthread_cond_destroy(&batch.released);
+    pthread_cond_destroy(&batch.finished);
+    pthread_cond_destroy(&batch.work);
+    pthread_mutex_destroy(&batch.lock);
+
+    return batch.failed ? 1 : 0;
+}